@@ -0,0 +1,45 @@
+/* Host benchmarks of the mdns_discovery component
+
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "sdkconfig.h"
+
+#define BENCH_SERVICE   "_service_49876"
+#define BENCH_PROTO     "_udp"
+
+/** Monotonic wall clock in nanoseconds */
+int64_t bench_now_ns(void);
+
+/** Deterministic random number in [0, n), seeded with CONFIG_BENCH_SEED */
+uint32_t bench_rand(uint32_t n);
+
+/** Percentile of n values, sorts v. Returns -1 if n is 0. */
+int64_t bench_percentile(int64_t *v, size_t n, int pct);
+
+/** Record a result. Lower is better for every metric; limit 0 means no threshold. */
+void bench_metric(const char *name, double value, const char *unit, double limit);
+
+/** Build the response a node of query-service sends: PTR, SRV, TXT and A records.
+ *	unicast builds the answer to a query from a port other than 5353, such as the watcher's.
+ *	@return packet length
+ */
+size_t bench_build_response(uint8_t *buf, size_t size, int node, bool unicast);
+
+/** TXT attribute lookup cost */
+void bench_txt(void);
+
+/** Peer table lookup cost at 10, 100 and 1000 peers */
+void bench_lookup(void);
+
+/** Nodes on a virtual network: time to first peer, packets per node and query latency */
+void bench_net(void);
@@ -0,0 +1,79 @@
+/* Peer table lookup benchmark
+
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "esp_log.h"
+#include "mdns_peers.h"
+#include "bench.h"
+
+static const char *TAG = "LOOKUP";
+
+static volatile uintptr_t s_sink;
+
+static double lookup_ns(int peers)
+{
+	mdns_peer_t *slots = calloc(peers, sizeof(mdns_peer_t));
+	if (!slots) {
+		ESP_LOGE(TAG, "out of memory");
+		exit(2);
+	}
+	mdns_peer_table_t table;
+	mdns_peer_table_init(&table, slots, peers, NULL, NULL, NULL);
+
+	// fill the table the way the watcher does, from responses
+	uint8_t pkt[512];
+	for (int i = 0; i < peers; i++) {
+		size_t len = bench_build_response(pkt, sizeof(pkt), i, false);
+		mdns_peer_table_ingest(&table, pkt, len, 0);
+	}
+	if (table.count != (size_t)peers) {
+		ESP_LOGE(TAG, "%zu of %d peers in the table", table.count, peers);
+		exit(2);
+	}
+
+	// look up the instance names of random peers, and one name in ten that is not there
+	enum { NAMES = 256 };
+	static char names[NAMES][MDNS_PEER_INSTANCE_MAX];
+	for (int i = 0; i < NAMES; i++) {
+		int node = i % 10 ? (int)bench_rand(peers) : peers + i;
+		snprintf(names[i], sizeof(names[i]), "ESP32 with mDNS %d", node);
+	}
+
+	// the same total work at every table size, so that small tables are not timed too briefly
+	int lookups = CONFIG_BENCH_LOOKUPS / peers;
+	if (lookups < 10000) lookups = 10000;
+	uintptr_t sum = 0;
+	int64_t start = bench_now_ns();
+	for (int i = 0; i < lookups; i++) {
+		sum += (uintptr_t)mdns_peer_table_find(&table, names[i % NAMES], BENCH_SERVICE, BENCH_PROTO);
+	}
+	int64_t ns = bench_now_ns() - start;
+	s_sink = sum;
+	free(slots);
+	return (double)ns / lookups;
+}
+
+void bench_lookup(void)
+{
+	static const struct {
+		int peers;
+		const char *name;
+		int limit;
+	} sizes[] = {
+		{10, "peer_lookup_10", CONFIG_BENCH_LIMIT_LOOKUP_10},
+		{100, "peer_lookup_100", CONFIG_BENCH_LIMIT_LOOKUP_100},
+		{1000, "peer_lookup_1000", CONFIG_BENCH_LIMIT_LOOKUP_1000},
+	};
+	for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+		double ns = lookup_ns(sizes[i].peers);
+		ESP_LOGI(TAG, "%d peers: %.1f ns/lookup", sizes[i].peers, ns);
+		bench_metric(sizes[i].name, ns, "ns", sizes[i].limit);
+	}
+}
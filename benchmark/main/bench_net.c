@@ -0,0 +1,338 @@
+/* Discovery on a virtual network
+
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <inttypes.h>
+#include "esp_log.h"
+#include "mdns_pkt.h"
+#include "mdns_peers.h"
+#include "mdns_query_schedule.h"
+#include "bench.h"
+
+static const char *TAG = "NET";
+
+/* Every node runs query-service: a responder for its own instance and a watcher of BENCH_SERVICE.
+ * The watcher sends its queries on an mdns_query_schedule_t and keeps peers in an mdns_peer_table_t,
+ * the responder behaves like the mdns component. The watcher queries from an ephemeral port, so it
+ * only receives the unicast answers to its own queries, never announcements.
+ * Time is virtual, in milliseconds. */
+
+#define PROBE_COUNT         3       // probes 250 ms apart before the first announcement (RFC 6762 8.1)
+#define PROBE_INTERVAL_MS   250
+#define ANNOUNCE_COUNT      2       // announcements 1 s apart (RFC 6762 8.3)
+#define ANNOUNCE_INTERVAL_MS 1000
+#define RESPONSE_MIN_MS     20      // shared answers are delayed 20-120 ms (RFC 6762 6)
+#define RESPONSE_MAX_MS     120
+
+typedef enum {
+	EV_BOOT,
+	EV_PROBE,
+	EV_ANNOUNCE,
+	EV_QUERY,
+	EV_RESPONSE,
+	EV_LOOKUP,
+} event_type_t;
+
+typedef struct {
+	int64_t t;
+	uint32_t seq;               // keeps events of the same time in order
+	uint16_t node;
+	uint8_t type;
+	uint8_t count;              // probe or announcement number
+	uint32_t gen;               // EV_QUERY: dropped if the node's schedule changed since,
+	                            // EV_RESPONSE: the node that asked
+} event_t;
+
+typedef struct {
+	int64_t boot_ms;
+	bool active;                // probing done, answers queries
+	mdns_query_service_t service;
+	mdns_query_schedule_t queries;
+	uint32_t query_gen;
+	int64_t first_peer_ms;      // -1 until the first peer is seen
+	int64_t lookup_ms;          // start of a lookup in progress, or -1
+	uint8_t response[512];      // the answer to a watcher's query
+	size_t response_len;
+	mdns_peer_table_t table;
+	mdns_peer_t *slots;
+} node_t;
+
+static struct {
+	node_t *nodes;
+	event_t *events;
+	size_t event_count;
+	size_t event_size;
+	uint32_t seq;
+	int64_t now_ms;
+	// packets sent while counting
+	bool counting;
+	uint64_t packets;
+	// query latency samples
+	int64_t *latency;
+	size_t latency_count;
+	size_t peers_max;           // most peers any node held at once
+} s_net;
+
+static bool before(const event_t *a, const event_t *b)
+{
+	return a->t < b->t || (a->t == b->t && a->seq < b->seq);
+}
+
+static void push(int64_t t, int node, event_type_t type, uint8_t count, uint32_t gen)
+{
+	if (s_net.event_count == s_net.event_size) {
+		s_net.event_size = s_net.event_size ? s_net.event_size * 2 : 256;
+		s_net.events = realloc(s_net.events, s_net.event_size * sizeof(event_t));
+		if (!s_net.events) {
+			ESP_LOGE(TAG, "out of memory");
+			exit(2);
+		}
+	}
+	event_t ev = { .t = t, .seq = s_net.seq++, .node = node, .type = type, .count = count, .gen = gen };
+	size_t i = s_net.event_count++;
+	while (i > 0 && before(&ev, &s_net.events[(i - 1) / 2])) {
+		s_net.events[i] = s_net.events[(i - 1) / 2];
+		i = (i - 1) / 2;
+	}
+	s_net.events[i] = ev;
+}
+
+static event_t pop(void)
+{
+	event_t top = s_net.events[0];
+	event_t last = s_net.events[--s_net.event_count];
+	size_t i = 0;
+	for (;;) {
+		size_t c = 2 * i + 1;
+		if (c >= s_net.event_count) break;
+		if (c + 1 < s_net.event_count && before(&s_net.events[c + 1], &s_net.events[c])) c++;
+		if (!before(&s_net.events[c], &last)) break;
+		s_net.events[i] = s_net.events[c];
+		i = c;
+	}
+	s_net.events[i] = last;
+	return top;
+}
+
+static bool lost(void)
+{
+	return bench_rand(1000) < CONFIG_BENCH_LOSS;
+}
+
+static void sent(void)
+{
+	if (s_net.counting) s_net.packets++;
+}
+
+static void peer_event(const mdns_peer_t *peer, mdns_peer_event_t event, void *ctx)
+{
+	node_t *n = ctx;
+	if (event != MDNS_PEER_ADDED) return;
+	if (n->table.count > s_net.peers_max) s_net.peers_max = n->table.count;
+	if (n->first_peer_ms < 0) n->first_peer_ms = s_net.now_ms - n->boot_ms;
+	if (n->lookup_ms >= 0) {
+		s_net.latency[s_net.latency_count++] = s_net.now_ms - n->lookup_ms;
+		n->lookup_ms = -1;
+	}
+}
+
+/* Unicast the answer of node from to the watcher of node to */
+static void send_response(int from, int to)
+{
+	sent();
+	node_t *src = &s_net.nodes[from];
+	if (lost()) return;
+	mdns_peer_table_ingest(&s_net.nodes[to].table, src->response, src->response_len, s_net.now_ms * 1000);
+}
+
+/* Multicast a query packet of the watcher of node ctx; every active responder answers it after a random delay */
+static void send_query(const uint8_t *buf, size_t len, int questions, void *ctx)
+{
+	int from = (node_t *)ctx - s_net.nodes;
+	sent();
+	for (int i = 0; i < CONFIG_BENCH_NODES; i++) {
+		node_t *n = &s_net.nodes[i];
+		if (i == from || !n->active || lost()) continue;
+		int64_t delay = RESPONSE_MIN_MS + bench_rand(RESPONSE_MAX_MS - RESPONSE_MIN_MS + 1);
+		push(s_net.now_ms + delay, i, EV_RESPONSE, 0, from);
+	}
+}
+
+/* Replace the pending query of node by the one its schedule has due next */
+static void schedule_query(int node)
+{
+	node_t *n = &s_net.nodes[node];
+	int64_t t = n->queries.next_us / 1000;
+	push(t > s_net.now_ms ? t : s_net.now_ms, node, EV_QUERY, 0, ++n->query_gen);
+}
+
+static void handle(const event_t *ev)
+{
+	node_t *n = &s_net.nodes[ev->node];
+	switch (ev->type) {
+	case EV_BOOT:
+		push(s_net.now_ms, ev->node, EV_PROBE, 0, 0);
+		mdns_query_schedule_add(&n->queries, BENCH_SERVICE, BENCH_PROTO);
+		schedule_query(ev->node);
+		break;
+	case EV_PROBE:
+		// probes are queries for our own name, nobody answers them when there is no conflict
+		sent();
+		if (ev->count + 1 < PROBE_COUNT) {
+			push(s_net.now_ms + PROBE_INTERVAL_MS, ev->node, EV_PROBE, ev->count + 1, 0);
+		} else {
+			push(s_net.now_ms + PROBE_INTERVAL_MS, ev->node, EV_ANNOUNCE, 0, 0);
+		}
+		break;
+	case EV_ANNOUNCE:
+		// multicast, heard by the mdns components of the peers but not by their watchers
+		n->active = true;
+		sent();
+		if (ev->count + 1 < ANNOUNCE_COUNT) {
+			push(s_net.now_ms + ANNOUNCE_INTERVAL_MS, ev->node, EV_ANNOUNCE, ev->count + 1, 0);
+		}
+		break;
+	case EV_QUERY: {
+		if (ev->gen != n->query_gen) break;
+		uint8_t buf[CONFIG_MDNS_WATCHER_PACKET_SIZE];
+		mdns_peer_table_expire(&n->table, s_net.now_ms * 1000);
+		mdns_query_schedule_poll(&n->queries, s_net.now_ms * 1000, buf, sizeof(buf), send_query, n);
+		schedule_query(ev->node);
+		break;
+	}
+	case EV_RESPONSE:
+		send_response(ev->node, ev->gen);
+		break;
+	case EV_LOOKUP:
+		// an application looks the service up again, with mdns_watcher_remove() and mdns_watcher_add()
+		mdns_query_schedule_remove(&n->queries, BENCH_SERVICE, BENCH_PROTO);
+		mdns_peer_table_remove_service(&n->table, BENCH_SERVICE, BENCH_PROTO);
+		mdns_query_schedule_add(&n->queries, BENCH_SERVICE, BENCH_PROTO);
+		n->lookup_ms = s_net.now_ms;
+		schedule_query(ev->node);
+		break;
+	}
+}
+
+static void run_until(int64_t end_ms)
+{
+	while (s_net.event_count && s_net.events[0].t <= end_ms) {
+		event_t ev = pop();
+		s_net.now_ms = ev.t;
+		handle(&ev);
+	}
+	s_net.now_ms = end_ms;
+}
+
+/* One cold start of the whole network, then the steady state, then lookups.
+ * Returns the packets sent in the steady state. */
+static uint64_t run(int64_t *first_peer, size_t *first_peer_count)
+{
+	s_net.event_count = 0;
+	s_net.now_ms = 0;
+	s_net.counting = false;
+	for (int i = 0; i < CONFIG_BENCH_NODES; i++) {
+		node_t *n = &s_net.nodes[i];
+		mdns_peer_t *slots = n->slots;
+		memset(n, 0, sizeof(*n));
+		n->slots = slots;
+		n->boot_ms = bench_rand(CONFIG_BENCH_BOOT_SPREAD + 1);
+		n->first_peer_ms = -1;
+		n->lookup_ms = -1;
+		n->response_len = bench_build_response(n->response, sizeof(n->response), i, true);
+		mdns_peer_table_init(&n->table, n->slots, CONFIG_BENCH_NODES, NULL, peer_event, n);
+		// as mdns_watcher_start() does for the short TTLs of unicast answers
+		n->table.min_ttl = 2 * CONFIG_MDNS_WATCHER_MAX_INTERVAL / 1000;
+		mdns_query_schedule_init(&n->queries, &n->service, 1);
+		push(n->boot_ms, i, EV_BOOT, 0, 0);
+	}
+
+	int64_t warmup_ms = (int64_t)CONFIG_BENCH_WARMUP * 60000;
+	run_until(warmup_ms);
+	for (int i = 0; i < CONFIG_BENCH_NODES; i++) {
+		if (s_net.nodes[i].first_peer_ms >= 0) first_peer[(*first_peer_count)++] = s_net.nodes[i].first_peer_ms;
+	}
+
+	s_net.counting = true;
+	s_net.packets = 0;
+	int64_t soak_end_ms = warmup_ms + (int64_t)CONFIG_BENCH_SOAK * 60000;
+	run_until(soak_end_ms);
+	s_net.counting = false;
+
+	// lookups spaced so that each one starts from the steady state
+	int64_t t = soak_end_ms;
+	for (int i = 0; i < CONFIG_BENCH_NET_LOOKUPS; i++) {
+		t += CONFIG_MDNS_WATCHER_MAX_INTERVAL;
+		push(t, bench_rand(CONFIG_BENCH_NODES), EV_LOOKUP, 0, 0);
+	}
+	run_until(t + CONFIG_MDNS_WATCHER_MAX_INTERVAL);
+	return s_net.packets;
+}
+
+void bench_net(void)
+{
+	s_net.peers_max = 0;
+	s_net.nodes = calloc(CONFIG_BENCH_NODES, sizeof(node_t));
+	int64_t *first_peer = calloc((size_t)CONFIG_BENCH_NODES * CONFIG_BENCH_RUNS, sizeof(int64_t));
+	s_net.latency = calloc((size_t)CONFIG_BENCH_NET_LOOKUPS * CONFIG_BENCH_RUNS, sizeof(int64_t));
+	if (!s_net.nodes || !first_peer || !s_net.latency) {
+		ESP_LOGE(TAG, "out of memory");
+		exit(2);
+	}
+	for (int i = 0; i < CONFIG_BENCH_NODES; i++) {
+		s_net.nodes[i].slots = calloc(CONFIG_BENCH_NODES, sizeof(mdns_peer_t));
+		if (!s_net.nodes[i].slots) {
+			ESP_LOGE(TAG, "out of memory");
+			exit(2);
+		}
+	}
+
+	size_t first_peer_count = 0;
+	uint64_t packets = 0;
+	for (int r = 0; r < CONFIG_BENCH_RUNS; r++) {
+		packets += run(first_peer, &first_peer_count);
+	}
+	size_t missing = (size_t)CONFIG_BENCH_NODES * CONFIG_BENCH_RUNS - first_peer_count;
+	size_t unanswered = (size_t)CONFIG_BENCH_NET_LOOKUPS * CONFIG_BENCH_RUNS - s_net.latency_count;
+
+	double per_node_minute = (double)packets / CONFIG_BENCH_RUNS / CONFIG_BENCH_NODES / CONFIG_BENCH_SOAK;
+	int64_t first_p50 = bench_percentile(first_peer, first_peer_count, 50);
+	int64_t first_p99 = bench_percentile(first_peer, first_peer_count, 99);
+	int64_t query_p50 = bench_percentile(s_net.latency, s_net.latency_count, 50);
+	int64_t query_p99 = bench_percentile(s_net.latency, s_net.latency_count, 99);
+	// what a watcher needs to hold every peer it saw: its table and as many slots,
+	// the storage mdns_watcher.c sizes with CONFIG_MDNS_WATCHER_MAX_PEERS
+	size_t table_bytes = sizeof(mdns_peer_table_t) + s_net.peers_max * sizeof(mdns_peer_t);
+
+	ESP_LOGI(TAG, "%d nodes, %d runs, %d%% loss, %zu bytes per peer",
+		CONFIG_BENCH_NODES, CONFIG_BENCH_RUNS, CONFIG_BENCH_LOSS / 10, sizeof(mdns_peer_t));
+	ESP_LOGI(TAG, "time to first peer: p50 %"PRId64" ms, p99 %"PRId64" ms, %zu nodes saw no peer",
+		first_p50, first_p99, missing);
+	ESP_LOGI(TAG, "steady state: %.1f packets per node per minute", per_node_minute);
+	ESP_LOGI(TAG, "query latency: p50 %"PRId64" ms, p99 %"PRId64" ms, %zu lookups unanswered",
+		query_p50, query_p99, unanswered);
+	ESP_LOGI(TAG, "peer table: %zu peers at most, %zu bytes per node", s_net.peers_max, table_bytes);
+
+	// a node that never finds a peer or a lookup that is never answered is a regression too
+	bench_metric("first_peer_p50", first_p50, "ms", 0);
+	bench_metric("first_peer_p99", missing ? 1e9 : first_p99, "ms", CONFIG_BENCH_LIMIT_FIRST_PEER);
+	bench_metric("packets_per_node_minute", per_node_minute, "packets", CONFIG_BENCH_LIMIT_PACKETS);
+	bench_metric("query_latency_p50", query_p50, "ms", 0);
+	bench_metric("query_latency_p99", unanswered ? 1e9 : query_p99, "ms", CONFIG_BENCH_LIMIT_QUERY);
+	bench_metric("peer_table_bytes", table_bytes, "bytes", CONFIG_BENCH_LIMIT_PEER_TABLE);
+
+	for (int i = 0; i < CONFIG_BENCH_NODES; i++) free(s_net.nodes[i].slots);
+	free(s_net.nodes);
+	free(s_net.events);
+	free(s_net.latency);
+	free(first_peer);
+}
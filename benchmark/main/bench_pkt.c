@@ -0,0 +1,150 @@
+/* mDNS responses of simulated nodes
+
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include "mdns_pkt.h"
+#include "bench.h"
+
+#define TTL_HOST    120     // SRV and A, as set by the mdns component
+#define TTL_OTHER   4500    // PTR and TXT
+#define TTL_UNICAST 10      // at most, in answers to legacy unicast queries
+
+typedef struct {
+	uint8_t *buf;
+	size_t size;
+	size_t len;
+	bool overflow;
+	bool unicast;
+} writer_t;
+
+static void put(writer_t *w, const void *data, size_t len)
+{
+	if (w->len + len > w->size) {
+		w->overflow = true;
+		return;
+	}
+	memcpy(w->buf + w->len, data, len);
+	w->len += len;
+}
+
+static void put_u16(writer_t *w, uint16_t v)
+{
+	uint8_t b[2] = {v >> 8, v};
+	put(w, b, 2);
+}
+
+static void put_u32(writer_t *w, uint32_t v)
+{
+	uint8_t b[4] = {v >> 24, v >> 16, v >> 8, v};
+	put(w, b, 4);
+}
+
+/* Dotted name as uncompressed labels. The instance label is written whole, it may contain spaces. */
+static void put_name(writer_t *w, const char *first_label, const char *rest)
+{
+	if (first_label) {
+		uint8_t l = strlen(first_label);
+		put(w, &l, 1);
+		put(w, first_label, l);
+	}
+	while (*rest) {
+		const char *dot = strchr(rest, '.');
+		uint8_t l = dot ? (size_t)(dot - rest) : strlen(rest);
+		put(w, &l, 1);
+		put(w, rest, l);
+		rest += l;
+		if (*rest) rest++;
+	}
+	uint8_t zero = 0;
+	put(w, &zero, 1);
+}
+
+static void put_rr_header(writer_t *w, uint16_t type, bool flush, uint32_t ttl)
+{
+	// legacy unicast answers have no cache-flush bit and short TTLs (RFC 6762 6.7)
+	if (w->unicast) {
+		flush = false;
+		if (ttl > TTL_UNICAST) ttl = TTL_UNICAST;
+	}
+	put_u16(w, type);
+	put_u16(w, flush ? 0x8001 : 0x0001);
+	put_u32(w, ttl);
+}
+
+/* Reserve the rdlength field; returns its offset for end_rdata() */
+static size_t begin_rdata(writer_t *w)
+{
+	size_t at = w->len;
+	put_u16(w, 0);
+	return at;
+}
+
+static void end_rdata(writer_t *w, size_t at)
+{
+	if (w->overflow) return;
+	uint16_t len = w->len - at - 2;
+	w->buf[at] = len >> 8;
+	w->buf[at + 1] = len;
+}
+
+static void put_txt_item(writer_t *w, const char *item)
+{
+	uint8_t l = strlen(item);
+	put(w, &l, 1);
+	put(w, item, l);
+}
+
+size_t bench_build_response(uint8_t *buf, size_t size, int node, bool unicast)
+{
+	char instance[32], service[64], host[48];
+	snprintf(instance, sizeof(instance), "ESP32 with mDNS %d", node);
+	snprintf(service, sizeof(service), "%s.%s.local", BENCH_SERVICE, BENCH_PROTO);
+	snprintf(host, sizeof(host), "esp32-mdns-%06X.local", node);
+
+	writer_t w = { .buf = buf, .size = size, .unicast = unicast };
+	static const uint8_t header[12] = {0, 0, 0x84, 0, 0, 0, 0, 4, 0, 0, 0, 0};
+	put(&w, header, sizeof(header));
+
+	// PTR <service> -> <instance>.<service>
+	put_name(&w, NULL, service);
+	put_rr_header(&w, MDNS_PKT_TYPE_PTR, false, TTL_OTHER);
+	size_t at = begin_rdata(&w);
+	put_name(&w, instance, service);
+	end_rdata(&w, at);
+
+	// SRV <instance>.<service> -> host:port
+	put_name(&w, instance, service);
+	put_rr_header(&w, MDNS_PKT_TYPE_SRV, true, TTL_HOST);
+	at = begin_rdata(&w);
+	put_u16(&w, 0);
+	put_u16(&w, 0);
+	put_u16(&w, 49876);
+	put_name(&w, NULL, host);
+	end_rdata(&w, at);
+
+	// TXT, the serviceTxtData of query-service
+	put_name(&w, instance, service);
+	put_rr_header(&w, MDNS_PKT_TYPE_TXT, true, TTL_OTHER);
+	at = begin_rdata(&w);
+	put_txt_item(&w, "board=esp32");
+	put_txt_item(&w, "u=user");
+	put_txt_item(&w, "p=password");
+	end_rdata(&w, at);
+
+	// A host -> 10.0.x.y
+	put_name(&w, NULL, host);
+	put_rr_header(&w, MDNS_PKT_TYPE_A, true, TTL_HOST);
+	at = begin_rdata(&w);
+	uint8_t addr[4] = {10, 0, node >> 8, node};
+	put(&w, addr, 4);
+	end_rdata(&w, at);
+
+	return w.overflow ? 0 : w.len;
+}
@@ -0,0 +1,181 @@
+/* TXT attribute lookup benchmark
+
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include "esp_log.h"
+#include "mdns_txt.h"
+#include "bench.h"
+
+static const char *TAG = "TXT";
+
+#define VALUE_LEN 8
+
+typedef struct {
+	uint8_t rdata[CONFIG_MDNS_TXT_SIZE];
+	size_t len;
+	mdns_txt_t txt;
+} peer_txt_t;
+
+static volatile size_t s_sink;
+
+/* "k00=<8 binary bytes>" ... plus "board=esp32" as the last item, like a large serviceTxtData */
+static size_t build_rdata(uint8_t *buf, size_t size, int keys, int peer)
+{
+	size_t len = 0;
+	for (int k = 0; k < keys; k++) {
+		char key[8];
+		int key_len = k == keys - 1 ? snprintf(key, sizeof(key), "board") : snprintf(key, sizeof(key), "k%02d", k);
+		size_t l = key_len + 1 + VALUE_LEN;
+		if (len + 1 + l > size) break;
+		buf[len] = l;
+		memcpy(buf + len + 1, key, key_len);
+		buf[len + 1 + key_len] = '=';
+		for (int i = 0; i < VALUE_LEN; i++) {
+			// binary values, including 0 bytes
+			buf[len + 2 + key_len + i] = (uint8_t)(peer * 31 + k * 7 + i * 64);
+		}
+		len += 1 + l;
+	}
+	return len;
+}
+
+/* What printing code does without an index: walk the items and compare every key */
+static const uint8_t *scan(const uint8_t *rdata, size_t len, const char *key, size_t key_len, size_t *value_len)
+{
+	for (size_t i = 0; i < len; i += 1 + rdata[i]) {
+		size_t l = rdata[i];
+		const uint8_t *item = rdata + i + 1;
+		if (l > key_len && item[key_len] == '=' && strncasecmp((const char *)item, key, key_len) == 0) {
+			*value_len = l - key_len - 1;
+			return item + key_len + 1;
+		}
+	}
+	return NULL;
+}
+
+static double report(const char *name, int64_t ns, int calls)
+{
+	double per_call = (double)ns / calls;
+	ESP_LOGI(TAG, "%-26s %8.1f ns/call", name, per_call);
+	return per_call;
+}
+
+void bench_txt(void)
+{
+	peer_txt_t *peers = calloc(CONFIG_BENCH_TXT_PEERS, sizeof(peer_txt_t));
+	if (!peers) {
+		ESP_LOGE(TAG, "out of memory");
+		exit(2);
+	}
+	for (int p = 0; p < CONFIG_BENCH_TXT_PEERS; p++) {
+		peers[p].len = build_rdata(peers[p].rdata, sizeof(peers[p].rdata), CONFIG_BENCH_TXT_KEYS, p);
+		mdns_txt_set(&peers[p].txt, peers[p].rdata, peers[p].len);
+	}
+	ESP_LOGI(TAG, "%d peers, %d keys and %zu bytes per peer, %u keys indexed",
+		CONFIG_BENCH_TXT_PEERS, CONFIG_BENCH_TXT_KEYS, peers[0].len, peers[0].txt.count);
+	if (peers[0].txt.count != CONFIG_BENCH_TXT_KEYS) {
+		ESP_LOGW(TAG, "raise CONFIG_MDNS_TXT_SIZE or CONFIG_MDNS_TXT_MAX_KEYS to index every key");
+	}
+
+	// the index must find exactly what a scan finds
+	for (int p = 0; p < CONFIG_BENCH_TXT_PEERS; p++) {
+		for (int k = 0; k < CONFIG_BENCH_TXT_KEYS; k++) {
+			char key[8];
+			snprintf(key, sizeof(key), k == CONFIG_BENCH_TXT_KEYS - 1 ? "BOARD" : "k%02d", k);
+			size_t len, scan_len;
+			const uint8_t *v = mdns_txt_get(&peers[p].txt, key, &len);
+			const uint8_t *s = scan(peers[p].rdata, peers[p].len, key, strlen(key), &scan_len);
+			if (!s && !v) continue;
+			// keys past CONFIG_MDNS_TXT_SIZE or CONFIG_MDNS_TXT_MAX_KEYS were never indexed, as warned above
+			if (!v && peers[p].txt.truncated) continue;
+			if (!s || !v || len != scan_len || memcmp(v, s, len) != 0) {
+				ESP_LOGE(TAG, "peer %d: lookup of %s does not match the record", p, key);
+				exit(2);
+			}
+		}
+	}
+
+	// items added one by one, as from the txt arrays of an mdns_result_t, must build the same store
+	static mdns_txt_t added;
+	mdns_txt_clear(&added);
+	for (size_t i = 0; i < peers[0].len; i += 1 + peers[0].rdata[i]) {
+		const uint8_t *item = peers[0].rdata + i + 1;
+		const uint8_t *eq = memchr(item, '=', peers[0].rdata[i]);
+		char key[16];
+		snprintf(key, sizeof(key), "%.*s", (int)(eq - item), (const char *)item);
+		mdns_txt_add(&added, key, eq + 1, peers[0].rdata[i] - (eq + 1 - item));
+	}
+	if (!peers[0].txt.truncated
+		&& (added.count != peers[0].txt.count || !mdns_txt_equal(&added, peers[0].rdata, peers[0].len))) {
+		ESP_LOGE(TAG, "mdns_txt_add() does not build the same attributes as mdns_txt_set()");
+		exit(2);
+	}
+
+	// a record that was not kept whole must still be told apart from another one
+	static uint8_t big[2][1536];
+	for (int r = 0; r < 2; r++) {
+		for (size_t i = 0; i < sizeof(big[r]); i += 256) {
+			big[r][i] = 255;
+			memset(big[r] + i + 1, 'a' + r, 255);
+		}
+	}
+	mdns_txt_t *txt = &peers[0].txt;
+	mdns_txt_set(txt, big[0], sizeof(big[0]));
+	if (!mdns_txt_equal(txt, big[0], sizeof(big[0])) || mdns_txt_equal(txt, big[1], sizeof(big[1]))
+		|| mdns_txt_equal(txt, big[0], sizeof(big[0]) - 256)) {
+		ESP_LOGE(TAG, "mdns_txt_equal() does not tell records that were not kept whole apart");
+		exit(2);
+	}
+	mdns_txt_set(txt, peers[0].rdata, peers[0].len);
+
+	// keys looked up in turn: the first item, one in the middle, the last item and a missing one
+	static const char *names[] = {"k00", "k25", "board", "missing"};
+	const int n = sizeof(names) / sizeof(names[0]);
+	mdns_txt_key_t keys[4];
+	for (int i = 0; i < n; i++) mdns_txt_key_init(&keys[i], names[i]);
+
+	size_t len, sum = 0;
+	int64_t start = bench_now_ns();
+	for (int i = 0; i < CONFIG_BENCH_LOOKUPS; i++) {
+		const uint8_t *v = mdns_txt_find(&peers[i % CONFIG_BENCH_TXT_PEERS].txt, &keys[i % n], &len);
+		if (v) sum += v[0] + len;
+	}
+	bench_metric("txt_find", report("mdns_txt_find (hashed)", bench_now_ns() - start, CONFIG_BENCH_LOOKUPS), "ns", 0);
+
+	start = bench_now_ns();
+	for (int i = 0; i < CONFIG_BENCH_LOOKUPS; i++) {
+		const uint8_t *v = mdns_txt_get(&peers[i % CONFIG_BENCH_TXT_PEERS].txt, names[i % n], &len);
+		if (v) sum += v[0] + len;
+	}
+	bench_metric("txt_get", report("mdns_txt_get", bench_now_ns() - start, CONFIG_BENCH_LOOKUPS), "ns", CONFIG_BENCH_LIMIT_TXT_GET);
+
+	start = bench_now_ns();
+	for (int i = 0; i < CONFIG_BENCH_LOOKUPS; i++) {
+		const peer_txt_t *peer = &peers[i % CONFIG_BENCH_TXT_PEERS];
+		const uint8_t *v = scan(peer->rdata, peer->len, keys[i % n].name, keys[i % n].len, &len);
+		if (v) sum += v[0] + len;
+	}
+	report("linear scan", bench_now_ns() - start, CONFIG_BENCH_LOOKUPS);
+
+	// indexing a record costs about as much as a hundred lookups, time fewer of them
+	const int sets = CONFIG_BENCH_LOOKUPS / 100;
+	start = bench_now_ns();
+	for (int i = 0; i < sets; i++) {
+		peer_txt_t *peer = &peers[i % CONFIG_BENCH_TXT_PEERS];
+		mdns_txt_set(&peer->txt, peer->rdata, peer->len);
+		sum += peer->txt.count;
+	}
+	bench_metric("txt_set", report("mdns_txt_set (per record)", bench_now_ns() - start, sets), "ns", 0);
+
+	s_sink = sum;
+	free(peers);
+}
@@ -0,0 +1,123 @@
+/* Host benchmarks of the mdns_discovery component
+
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <time.h>
+#include "esp_log.h"
+#include "bench.h"
+
+static const char *TAG = "BENCH";
+
+#define MAX_METRICS 32
+
+typedef struct {
+	const char *name;
+	double value;
+	const char *unit;
+	double limit;
+} metric_t;
+
+static metric_t s_metrics[MAX_METRICS];
+static int s_metric_count;
+static uint64_t s_rng = CONFIG_BENCH_SEED;
+
+int64_t bench_now_ns(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+uint32_t bench_rand(uint32_t n)
+{
+	// xorshift64*, the same sequence on every host
+	s_rng ^= s_rng >> 12;
+	s_rng ^= s_rng << 25;
+	s_rng ^= s_rng >> 27;
+	return (uint32_t)((s_rng * 2685821657736338717ULL) >> 32) % n;
+}
+
+static int cmp_i64(const void *a, const void *b)
+{
+	int64_t x = *(const int64_t *)a, y = *(const int64_t *)b;
+	return x < y ? -1 : x > y;
+}
+
+int64_t bench_percentile(int64_t *v, size_t n, int pct)
+{
+	if (n == 0) return -1;
+	qsort(v, n, sizeof(int64_t), cmp_i64);
+	return v[(n - 1) * pct / 100];
+}
+
+void bench_metric(const char *name, double value, const char *unit, double limit)
+{
+	if (s_metric_count == MAX_METRICS) {
+		ESP_LOGE(TAG, "too many metrics, %s dropped", name);
+		return;
+	}
+	s_metrics[s_metric_count++] = (metric_t) {name, value, unit, limit};
+}
+
+static bool passed(const metric_t *m)
+{
+	return m->limit <= 0 || m->value <= m->limit;
+}
+
+static bool write_json(const char *path)
+{
+	FILE *f = fopen(path, "w");
+	if (!f) return false;
+	fprintf(f, "{\n  \"seed\": %d,\n  \"metrics\": {\n", CONFIG_BENCH_SEED);
+	for (int i = 0; i < s_metric_count; i++) {
+		const metric_t *m = &s_metrics[i];
+		fprintf(f, "    \"%s\": {\"value\": %.3f, \"unit\": \"%s\", ", m->name, m->value, m->unit);
+		if (m->limit > 0) {
+			fprintf(f, "\"threshold\": %.3f, ", m->limit);
+		} else {
+			fprintf(f, "\"threshold\": null, ");
+		}
+		fprintf(f, "\"pass\": %s}%s\n", passed(m) ? "true" : "false", i + 1 < s_metric_count ? "," : "");
+	}
+	fprintf(f, "  }\n}\n");
+	return fclose(f) == 0;
+}
+
+void app_main(void)
+{
+	bench_net();
+	bench_lookup();
+	bench_txt();
+
+	int failed = 0;
+	printf("%-28s %14s %14s  %s\n", "metric", "value", "threshold", "unit");
+	for (int i = 0; i < s_metric_count; i++) {
+		const metric_t *m = &s_metrics[i];
+		char limit[24] = "-";
+		if (m->limit > 0) snprintf(limit, sizeof(limit), "%.1f", m->limit);
+		printf("%-28s %14.1f %14s  %s%s\n", m->name, m->value, limit, m->unit, passed(m) ? "" : "  REGRESSED");
+		if (!passed(m)) failed++;
+	}
+
+	const char *path = getenv("MDNS_BENCH_JSON");
+	if (!path) path = CONFIG_BENCH_JSON_FILE;
+	if (!write_json(path)) {
+		ESP_LOGE(TAG, "cannot write %s", path);
+		exit(2);
+	}
+	ESP_LOGI(TAG, "results written to %s", path);
+
+	if (failed) {
+		ESP_LOGE(TAG, "%d metrics past their threshold", failed);
+		exit(1);
+	}
+	exit(0);
+}
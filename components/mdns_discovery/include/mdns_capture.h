@@ -0,0 +1,32 @@
+/* Stream mDNS traffic to a collector in pcap format
+
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_err.h"
+
+/** Start the capture task.
+ *	The task connects to CONFIG_MDNS_CAPTURE_HOST:CONFIG_MDNS_CAPTURE_PORT over TCP and streams
+ *	a pcap file of every captured packet. Timestamps are microseconds since boot.
+ *	The watcher captures only its own queries and the unicast answers to them.
+ *	Receive it with e.g. "nc -l 19000 > capture.pcap".
+ */
+esp_err_t mdns_capture_start(void);
+
+/** Queue one mDNS packet for capture. Never blocks; the packet is dropped if the buffer is full.
+ *	src_ip or dst_ip may be NULL for this node, in which case the station address is used.
+ */
+void mdns_capture_packet(const uint8_t src_ip[4], uint16_t src_port,
+	const uint8_t dst_ip[4], uint16_t dst_port,
+	const uint8_t *payload, size_t len);
+
+/** Number of packets captured and dropped so far */
+void mdns_capture_get_stats(uint32_t *captured, uint32_t *dropped);
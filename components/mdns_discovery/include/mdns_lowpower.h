@@ -0,0 +1,38 @@
+/* Duty-cycled low-power discovery
+
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_err.h"
+
+/** Start duty cycling.
+ *	The radio is kept on (WIFI_PS_NONE) during wake windows of CONFIG_MDNS_LP_WINDOW ms every
+ *	CONFIG_MDNS_LP_PERIOD ms, and in modem sleep (WIFI_PS_MAX_MODEM) in between.
+ *	The window phase is advertised in the "lpw" TXT item of <service>.<proto>. A joining node adopts
+ *	the phase of the established peers, and otherwise the lowest phase wins (mdns_lp_adopt_phase()),
+ *	so that all peers wake together.
+ *	Window times are taken from the system clock, which is set by SNTP. The radio stays on until
+ *	SNTP has set it, so without an NTP server the node never sleeps, but still discovers its peers.
+ *	After that a new node keeps the radio on for up to CONFIG_MDNS_LP_JOIN_TIME ms until it hears a peer's phase.
+ *	While it looks for peers, it queries at mdns_lowpower_join_interval_ms() rather than backing off.
+ */
+esp_err_t mdns_lowpower_start(const char *service, const char *proto);
+
+/** Returns 0 inside a wake window, otherwise the time in microseconds until the next one. */
+int64_t mdns_lowpower_delay_us(void);
+
+/** Returns the longest time in milliseconds between queries while no peer phase has been seen
+ *	and the join time has not run out, otherwise 0. The join time runs both before SNTP has set the clock and after.
+ */
+uint32_t mdns_lowpower_join_interval_ms(void);
+
+/** Look for the window phase of peers in a received mDNS response. */
+void mdns_lowpower_ingest(const uint8_t *buf, size_t len);
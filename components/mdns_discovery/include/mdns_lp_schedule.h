@@ -0,0 +1,54 @@
+/* Wake window schedule for low-power discovery
+
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+/* TXT key carrying "<period>:<phase>" in milliseconds, followed by ":j" while the node is joining */
+#define MDNS_LP_TXT_KEY "lpw"
+
+/* Windows start at every time t (ms since the epoch) where t % period_ms == phase_ms. */
+typedef struct {
+	uint32_t period_ms;
+	uint32_t window_ms;
+	uint32_t phase_ms;
+	bool joining;           // still looking for the phase of an established peer
+} mdns_lp_schedule_t;
+
+/** Returns true if now_ms is inside a wake window */
+bool mdns_lp_in_window(const mdns_lp_schedule_t *s, int64_t now_ms);
+
+/** Returns the start of the wake window containing now_ms, or of the next one */
+int64_t mdns_lp_window_start(const mdns_lp_schedule_t *s, int64_t now_ms);
+
+/** Returns the query interval of a node that is looking for the cluster's windows.
+ *	Two queries per window put one in the first half of every window, which is answered before
+ *	the window ends if the window is longer than twice the peers' response delay (up to 120 ms).
+ */
+uint32_t mdns_lp_join_interval(const mdns_lp_schedule_t *s);
+
+/** Adopt a peer's phase. A joining node takes the phase of any established peer, since that is
+ *	the phase the cluster wakes at, and ignoring it would split the cluster. An established node
+ *	ignores joining peers. Otherwise the lower phase wins, so that nodes booting together, or
+ *	clusters that meet, converge on one phase.
+ *	@return true if the phase changed
+ */
+bool mdns_lp_adopt_phase(mdns_lp_schedule_t *s, uint32_t peer_phase_ms, bool peer_joining);
+
+/** Format the TXT value advertising this schedule. */
+void mdns_lp_format_txt(const mdns_lp_schedule_t *s, char *out, size_t size);
+
+/** Find the phase advertised with our period in the TXT records of an mDNS response: the lowest
+ *	phase of an established peer, or if there is none, the lowest phase of a joining one.
+ *	@return false if the packet advertises no phase for our period
+ */
+bool mdns_lp_find_phase(const mdns_lp_schedule_t *s, const uint8_t *buf, size_t len, uint32_t *phase_ms, bool *joining);
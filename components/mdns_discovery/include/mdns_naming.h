@@ -0,0 +1,50 @@
+/* Conflict-aware mDNS hostname
+
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include "esp_err.h"
+#include "sdkconfig.h"
+
+/* Called when the hostname in use differs from the requested one,
+ * either because a probe found it taken or because mDNS renamed us later. */
+typedef void (*mdns_naming_cb_t)(const char *requested, const char *actual, void *ctx);
+
+#if CONFIG_MDNS_DISCOVERY_METRICS
+typedef struct {
+	int64_t preprobe_us;    // time spent querying candidate names before one was set (CONFIG_MDNS_PREPROBE)
+	int64_t settle_us;      // time from the last mdns_naming_set_hostname() until the hostname last changed,
+	                        // as seen by the rename check every CONFIG_MDNS_NAMING_CHECK_INTERVAL ms.
+	                        // Added once the name has not changed for a second.
+	uint32_t probes;        // candidate names probed
+	uint32_t conflicts;     // candidate names found taken, plus renames done by mDNS
+} mdns_naming_metrics_t;
+
+void mdns_naming_get_metrics(mdns_naming_metrics_t *metrics);
+#endif
+
+/** Set the mDNS hostname, falling back to a deterministic name on conflict.
+ *	Candidates are tried in this order:
+ *	- requested
+ *	- <prefix>-<full MAC address>
+ *	- <prefix>-<full MAC address>-2, -3, ...
+ *	The name is taken as claimed once it has not changed for a second, which outlives the mDNS probe.
+ *	If mDNS renames the requested name, e.g. because another node claimed it at the same time,
+ *	the MAC based name is set instead.
+ *	With CONFIG_MDNS_PREPROBE each candidate is queried for A and AAAA records before it is set,
+ *	so that the node comes up under a free name instead of going through the mDNS probe/rename cycle.
+ *	This costs CONFIG_MDNS_PREPROBE_TIMEOUT per candidate, also when the requested name is free.
+ *	If every candidate is taken, the last one is set and mDNS resolves the conflict.
+ *	mdns_init() must have been called.
+ */
+esp_err_t mdns_naming_set_hostname(const char *requested, const char *prefix, mdns_naming_cb_t cb, void *ctx);
+
+/** Copy the hostname currently in use. buf must hold at least 64 bytes. */
+esp_err_t mdns_naming_get_hostname(char *buf);
@@ -0,0 +1,65 @@
+/* pcap writer/reader for mDNS traffic
+
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#define MDNS_PCAP_FILE_HEADER_LEN   24
+#define MDNS_PCAP_RECORD_HEADER_LEN 16
+#define MDNS_PCAP_IP_UDP_LEN        28
+
+/* Bytes needed by mdns_pcap_record() for a payload of len bytes */
+#define MDNS_PCAP_RECORD_LEN(len)   (MDNS_PCAP_RECORD_HEADER_LEN + MDNS_PCAP_IP_UDP_LEN + (len))
+
+/** Write a pcap file header for raw IPv4 packets (LINKTYPE_RAW).
+ *	@return MDNS_PCAP_FILE_HEADER_LEN
+ */
+size_t mdns_pcap_file_header(uint8_t *out);
+
+/** Write one pcap record holding an IPv4/UDP packet with the given payload.
+ *	out must hold MDNS_PCAP_RECORD_LEN(len) bytes.
+ *	@return number of bytes written
+ */
+size_t mdns_pcap_record(uint8_t *out, int64_t ts_us,
+	const uint8_t src_ip[4], uint16_t src_port,
+	const uint8_t dst_ip[4], uint16_t dst_port,
+	const uint8_t *payload, size_t len);
+
+typedef struct {
+	const uint8_t *buf;
+	size_t len;
+	size_t pos;
+	bool swapped;           // file was written on a host of the other byte order
+	bool nanosecond;
+	uint32_t linktype;
+} mdns_pcap_reader_t;
+
+/* One UDP datagram from a capture. payload points into the capture buffer. */
+typedef struct {
+	int64_t ts_us;
+	uint8_t src_ip[4];
+	uint8_t dst_ip[4];
+	uint16_t src_port;
+	uint16_t dst_port;
+	const uint8_t *payload;
+	size_t len;
+} mdns_pcap_packet_t;
+
+/** Open a capture held in memory. Ethernet, Linux cooked and raw IPv4 captures are supported.
+ *	@return false if buf is not a pcap file or uses an unsupported link type
+ */
+bool mdns_pcap_reader_init(mdns_pcap_reader_t *r, const uint8_t *buf, size_t len);
+
+/** Return the next IPv4/UDP datagram to or from the mDNS port. Other packets are skipped.
+ *	@return false at the end of the capture
+ */
+bool mdns_pcap_reader_next(mdns_pcap_reader_t *r, mdns_pcap_packet_t *pkt);
@@ -0,0 +1,99 @@
+/* Peer table fed from mDNS responses
+
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "sdkconfig.h"
+#if CONFIG_MDNS_DISCOVERY_TXT
+#include "mdns_txt.h"
+#endif
+
+#define MDNS_PEER_INSTANCE_MAX  64
+#define MDNS_PEER_SERVICE_MAX   32
+#define MDNS_PEER_PROTO_MAX     8
+#define MDNS_PEER_HOSTNAME_MAX  64
+
+typedef struct {
+	bool used;
+	uint32_t key;                               // hash of instance/service/proto
+	char instance[MDNS_PEER_INSTANCE_MAX];      // "ESP32 with mDNS"
+	char service[MDNS_PEER_SERVICE_MAX];        // "_service_49876"
+	char proto[MDNS_PEER_PROTO_MAX];            // "_udp"
+	char hostname[MDNS_PEER_HOSTNAME_MAX];      // "esp32-mdns-05C634", without ".local"
+	uint16_t port;
+#if CONFIG_MDNS_DISCOVERY_A
+	uint8_t ip4[4];                             // all zero until an A record is seen
+#endif
+#if CONFIG_MDNS_DISCOVERY_AAAA
+	uint8_t ip6[16];                            // all zero until an AAAA record is seen
+#endif
+#if CONFIG_MDNS_DISCOVERY_TXT
+	mdns_txt_t txt;                             // read with mdns_txt_get(&peer->txt, "board", &len)
+#endif
+	int64_t expires_us;
+	int64_t last_seen_us;
+} mdns_peer_t;
+
+typedef enum {
+	MDNS_PEER_ADDED,
+	MDNS_PEER_UPDATED,
+	MDNS_PEER_REMOVED,
+} mdns_peer_event_t;
+
+typedef void (*mdns_peer_cb_t)(const mdns_peer_t *peer, mdns_peer_event_t event, void *ctx);
+
+/* Returns true if PTR answers for <service>.<proto> should create peers. */
+typedef bool (*mdns_peer_filter_t)(const char *service, const char *proto, void *ctx);
+
+#if CONFIG_MDNS_DISCOVERY_METRICS
+typedef struct {
+	uint32_t packets;       // responses ingested
+	uint32_t records;       // resource records read
+	uint32_t malformed;     // responses that could not be parsed to the end
+	uint32_t full;          // new peers dropped because the table was full
+} mdns_peer_table_metrics_t;
+#endif
+
+typedef struct {
+	mdns_peer_t *slots;
+	size_t size;
+	size_t count;
+	uint32_t min_ttl;       // seconds a record keeps a peer alive at least, whatever its TTL; 0 after init
+	mdns_peer_filter_t filter;
+	mdns_peer_cb_t cb;
+	void *ctx;
+#if CONFIG_MDNS_DISCOVERY_METRICS
+	mdns_peer_table_metrics_t metrics;
+#endif
+} mdns_peer_table_t;
+
+/** Initialise a peer table on caller-provided storage.
+ *	filter and cb may be NULL; a NULL filter accepts every service.
+ */
+void mdns_peer_table_init(mdns_peer_table_t *t, mdns_peer_t *slots, size_t size,
+	mdns_peer_filter_t filter, mdns_peer_cb_t cb, void *ctx);
+
+/** Apply every record of a received mDNS response to the table.
+ *	@return number of peers added or updated
+ */
+int mdns_peer_table_ingest(mdns_peer_table_t *t, const uint8_t *buf, size_t len, int64_t now_us);
+
+/** Remove peers whose TTL ran out before now_us. */
+void mdns_peer_table_expire(mdns_peer_table_t *t, int64_t now_us);
+
+/** Remove every peer of <service>.<proto>. */
+void mdns_peer_table_remove_service(mdns_peer_table_t *t, const char *service, const char *proto);
+
+/** Find a peer by instance name, service and protocol.
+ *	@return NULL if the peer is not known
+ */
+mdns_peer_t *mdns_peer_table_find(mdns_peer_table_t *t, const char *instance, const char *service, const char *proto);
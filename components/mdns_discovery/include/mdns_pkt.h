@@ -0,0 +1,64 @@
+/* Minimal mDNS packet builder/parser
+
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#define MDNS_PKT_PORT       5353
+#define MDNS_PKT_GROUP      "224.0.0.251"
+#define MDNS_PKT_NAME_MAX   256
+
+#define MDNS_PKT_TYPE_A     1
+#define MDNS_PKT_TYPE_PTR   12
+#define MDNS_PKT_TYPE_TXT   16
+#define MDNS_PKT_TYPE_AAAA  28
+#define MDNS_PKT_TYPE_SRV   33
+
+/* One resource record, decoded from a packet.
+ * rdata points into the packet buffer, nothing is copied except the names. */
+typedef struct {
+	char name[MDNS_PKT_NAME_MAX];   // owner name, dotted, without trailing dot
+	uint16_t type;
+	uint16_t rclass;                // cache-flush bit removed
+	uint32_t ttl;
+	const uint8_t *rdata;
+	uint16_t rdlen;
+	char target[MDNS_PKT_NAME_MAX]; // PTR/SRV target name
+	uint16_t port;                  // SRV port
+} mdns_pkt_rr_t;
+
+typedef struct {
+	const uint8_t *buf;
+	size_t len;
+	size_t pos;
+	uint16_t flags;
+	uint16_t remaining;             // records left to read (an+ns+ar)
+	bool malformed;                 // reading stopped at a malformed record
+} mdns_pkt_parser_t;
+
+/** Begin parsing a packet. Questions are skipped.
+ *	@return false if the packet is malformed or is a query
+ */
+bool mdns_pkt_parser_init(mdns_pkt_parser_t *p, const uint8_t *buf, size_t len);
+
+/** Read the next resource record.
+ *	@return false at the end of the packet or on a malformed record
+ */
+bool mdns_pkt_parser_next(mdns_pkt_parser_t *p, mdns_pkt_rr_t *rr);
+
+/** Start a query packet with no questions. */
+size_t mdns_pkt_query_begin(uint8_t *buf, size_t size);
+
+/** Append a PTR question for <service>.<proto>.local to a query packet.
+ *	@return new packet length, or 0 if the question does not fit in size bytes
+ */
+size_t mdns_pkt_query_add_ptr(uint8_t *buf, size_t len, size_t size, const char *service, const char *proto);
@@ -0,0 +1,40 @@
+/* One-shot mDNS queries
+
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "mdns.h"
+#if CONFIG_MDNS_DISCOVERY_TXT
+#include "mdns_txt.h"
+#endif
+
+/** Print every result of an mDNS query.
+ *	TXT items and AAAA addresses are printed only with CONFIG_MDNS_DISCOVERY_TXT and CONFIG_MDNS_DISCOVERY_AAAA.
+ */
+void mdns_discovery_print_results(const mdns_result_t *results);
+
+#if CONFIG_MDNS_DISCOVERY_TXT
+/** Index the TXT items of one result, as mdns_txt_set() does for a record from a packet.
+ *	@return false if some items did not fit; the ones that did are kept
+ */
+bool mdns_discovery_txt_from_result(const mdns_result_t *result, mdns_txt_t *txt);
+#endif
+
+/** Query <service>.<proto>.local with mdns_query_ptr() and print the results.
+ *	@return ESP_ERR_NOT_FOUND if nobody answered within timeout_ms
+ */
+esp_err_t mdns_discovery_query_service(const char *service, const char *proto, uint32_t timeout_ms);
+
+/** Query <host_name>.local with mdns_query_a() and log the address.
+ *	addr may be NULL.
+ */
+esp_err_t mdns_discovery_query_host(const char *host_name, uint32_t timeout_ms, esp_ip4_addr_t *addr);
@@ -0,0 +1,67 @@
+/* Query schedule of the watcher
+
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "sdkconfig.h"
+#include "mdns_peers.h"
+
+typedef struct {
+	bool used;
+	char service[MDNS_PEER_SERVICE_MAX];
+	char proto[MDNS_PEER_PROTO_MAX];
+	int64_t next_us;        // the next query for this service is due at this time
+	uint32_t interval_ms;   // and the one after it interval_ms later
+} mdns_query_service_t;
+
+/* Called with every packet of PTR questions that is due */
+typedef void (*mdns_query_send_t)(const uint8_t *buf, size_t len, int questions, void *ctx);
+
+/* The services to ask for and when. Each service has its own interval, which starts at CONFIG_MDNS_WATCHER_MIN_INTERVAL
+ * when the service is added and doubles after every query, up to CONFIG_MDNS_WATCHER_MAX_INTERVAL, like a continuous
+ * mDNS querier (RFC 6762 5.2). Services that are due together share a packet. No clock and no socket, so that
+ * simulations run the same code. */
+typedef struct {
+	mdns_query_service_t *services;
+	size_t size;
+	size_t count;
+	int64_t next_us;        // the earliest query of all services is due at this time, INT64_MAX without services
+} mdns_query_schedule_t;
+
+/** Initialise a schedule with no services on caller-provided storage. */
+void mdns_query_schedule_init(mdns_query_schedule_t *s, mdns_query_service_t *services, size_t size);
+
+/** Returns the entry of <service>.<proto>, or NULL if it is not in the schedule. */
+const mdns_query_service_t *mdns_query_schedule_find(const mdns_query_schedule_t *s, const char *service, const char *proto);
+
+/** Add <service>.<proto> and query for it at once, leaving the backoff of the other services alone. service and proto must fit in mdns_query_service_t.
+ *	@return false if every entry is used
+ */
+bool mdns_query_schedule_add(mdns_query_schedule_t *s, const char *service, const char *proto);
+
+/** Remove <service>.<proto>.
+ *	@return false if it was not in the schedule
+ */
+bool mdns_query_schedule_remove(mdns_query_schedule_t *s, const char *service, const char *proto);
+
+/** Move every query due before t_us to t_us, e.g. to the next time the radio is on. */
+void mdns_query_schedule_defer(mdns_query_schedule_t *s, int64_t t_us);
+
+/** Move every query due after t_us to t_us. The backoff goes on from where it was. */
+void mdns_query_schedule_advance(mdns_query_schedule_t *s, int64_t t_us);
+
+/** If queries are due at now_us, pack the PTR questions of those services into as few packets
+ *	of at most size bytes as possible, pass each to send and schedule their next queries.
+ *	@return number of questions sent, 0 if no query was due
+ */
+int mdns_query_schedule_poll(mdns_query_schedule_t *s, int64_t now_us, uint8_t *buf, size_t size,
+	mdns_query_send_t send, void *ctx);
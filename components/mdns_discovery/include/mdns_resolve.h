@@ -0,0 +1,37 @@
+/* Deadline-aware mDNS host resolver
+
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "esp_netif_ip_addr.h"
+
+typedef struct {
+	esp_ip4_addr_t addr;
+	bool fresh;             // false if addr is a stale answer being revalidated in the background
+	uint32_t age_ms;        // time since addr was last confirmed
+} mdns_resolve_result_t;
+
+/** Start the resolver task. mdns_init() must have been called. */
+esp_err_t mdns_resolve_init(void);
+
+/** Resolve <host_name>.local, waiting at most deadline_ms.
+ *	- a fresh cached answer is returned immediately
+ *	- a stale answer, no older than CONFIG_MDNS_RESOLVE_FRESH + CONFIG_MDNS_RESOLVE_STALE,
+ *	  is returned immediately and revalidated in the background
+ *	- otherwise a query, limited to the deadline, is started and the call waits for it
+ *	Queries for different names run at the same time, so a host that does not answer
+ *	does not delay the lookup of another one.
+ *	A deadline of 0 only looks at the cache, and starts a query for later calls.
+ *	@return ESP_ERR_TIMEOUT if the deadline passed before the query finished,
+ *	        ESP_ERR_NOT_FOUND if the host did not answer
+ */
+esp_err_t mdns_resolve_host(const char *host_name, uint32_t deadline_ms, mdns_resolve_result_t *result);
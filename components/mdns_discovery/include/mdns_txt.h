@@ -0,0 +1,81 @@
+/* Indexed TXT attributes
+
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "sdkconfig.h"
+
+/* The index is kept at most half full, so a lookup touches one or two slots. */
+#define MDNS_TXT_SLOTS (2 * CONFIG_MDNS_TXT_MAX_KEYS)
+
+/* Where one "key=value" item lives in raw. 0 in hash marks an empty slot. */
+typedef struct {
+	uint16_t hash;
+	uint16_t key;           // offset of the key in raw
+	uint8_t key_len;
+	uint8_t value_len;      // the value starts after the key and '='
+	bool has_value;         // false for a boolean attribute written without '='
+} mdns_txt_slot_t;
+
+/* TXT rdata as received (a sequence of length prefixed "key=value" strings)
+ * and a hash index of its keys. Values are returned as pointers into raw, never copied,
+ * and may contain any byte including 0. */
+typedef struct {
+	uint16_t len;
+	uint8_t count;
+	bool truncated;         // the last mdns_txt_set() did not keep every item
+	uint16_t rdata_len;     // the whole rdata, kept or not, for mdns_txt_equal()
+	uint32_t rdata_hash;    // set only when raw is not a copy of the rdata
+	uint8_t raw[CONFIG_MDNS_TXT_SIZE];
+	mdns_txt_slot_t index[MDNS_TXT_SLOTS];
+} mdns_txt_t;
+
+/* A key hashed once, for lookups in a loop */
+typedef struct {
+	const char *name;
+	uint8_t len;
+	uint16_t hash;
+} mdns_txt_key_t;
+
+/** Remove every attribute. */
+void mdns_txt_clear(mdns_txt_t *txt);
+
+/** Replace the attributes with TXT rdata from a packet, and index them.
+ *	Keys are case insensitive and only the first item with a given key counts (RFC 6763).
+ *	@return false if some items did not fit in CONFIG_MDNS_TXT_SIZE or CONFIG_MDNS_TXT_MAX_KEYS
+ *	        or the rdata is malformed; the items before that are kept
+ */
+bool mdns_txt_set(mdns_txt_t *txt, const uint8_t *rdata, size_t len);
+
+/** Append one attribute, e.g. from the txt and txt_value_len arrays of an mdns_result_t.
+ *	value may be NULL for a boolean attribute. value_len counts every byte, the value need not be a string.
+ *	@return false if the attribute does not fit or the key is already set
+ */
+bool mdns_txt_add(mdns_txt_t *txt, const char *key, const uint8_t *value, size_t value_len);
+
+/** Returns true if rdata holds the same attributes as txt, i.e. mdns_txt_set() would change nothing.
+ *	A record that was not kept whole is compared by its length and a 32 bit hash.
+ */
+bool mdns_txt_equal(const mdns_txt_t *txt, const uint8_t *rdata, size_t len);
+
+/** Hash a key for mdns_txt_find(). name must outlive key. */
+void mdns_txt_key_init(mdns_txt_key_t *key, const char *name);
+
+/** Look up a hashed key.
+ *	@return pointer to the value inside txt and its length in *len,
+ *	        a non-NULL pointer with *len 0 for a boolean attribute,
+ *	        NULL if the key is not present
+ */
+const uint8_t *mdns_txt_find(const mdns_txt_t *txt, const mdns_txt_key_t *key, size_t *len);
+
+/** Look up a key, see mdns_txt_find(). */
+const uint8_t *mdns_txt_get(const mdns_txt_t *txt, const char *name, size_t *len);
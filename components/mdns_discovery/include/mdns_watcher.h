@@ -0,0 +1,52 @@
+/* Multi-service mDNS watcher
+
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#pragma once
+
+#include "esp_err.h"
+#include "mdns_peers.h"
+
+/** Start the watcher task.
+ *	All watched services share one query schedule, and their PTR questions are packed
+ *	into as few packets as CONFIG_MDNS_WATCHER_PACKET_SIZE allows.
+ *	Queries are sent from an ephemeral port, not 5353, so the watcher runs next to the mdns component.
+ *	Responders answer them with unicast responses; announcements and goodbyes multicast by peers
+ *	are not seen, and a peer is removed once it stops answering.
+ *	cb is called from the watcher task whenever a peer is added, updated or removed; it may be NULL.
+ */
+esp_err_t mdns_watcher_start(mdns_peer_cb_t cb, void *ctx);
+
+/** Stop the watcher task and forget all services and peers. */
+void mdns_watcher_stop(void);
+
+/** Start watching <service>.<proto>. Can be called at any time after mdns_watcher_start().
+ *	@return ESP_ERR_NO_MEM if CONFIG_MDNS_WATCHER_MAX_SERVICES are already watched
+ */
+esp_err_t mdns_watcher_add(const char *service, const char *proto);
+
+/** Stop watching <service>.<proto> and drop its peers.
+ *	@return ESP_ERR_NOT_FOUND if the service was not watched
+ */
+esp_err_t mdns_watcher_remove(const char *service, const char *proto);
+
+#if CONFIG_MDNS_DISCOVERY_METRICS
+typedef struct {
+	uint32_t queries;           // PTR questions sent
+	uint32_t packets_sent;
+	uint32_t packets_received;
+	mdns_peer_table_metrics_t peers;
+} mdns_watcher_metrics_t;
+
+void mdns_watcher_get_metrics(mdns_watcher_metrics_t *metrics);
+#endif
+
+/** Copy up to max peers out of the peer table.
+ *	@return number of peers copied
+ */
+size_t mdns_watcher_get_peers(mdns_peer_t *peers, size_t max);
@@ -0,0 +1,113 @@
+/* Stream mDNS traffic to a collector in pcap format
+
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#include "mdns_log.h"
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/ringbuf.h"
+#include "esp_timer.h"
+#include "esp_netif.h"
+#include "lwip/sockets.h"
+#include "mdns_pcap.h"
+#include "mdns_capture.h"
+
+static const char *TAG = "CAPTURE";
+
+static struct {
+	RingbufHandle_t rb;
+	uint32_t captured;
+	uint32_t dropped;
+} s_capture;
+
+static void local_ip(uint8_t ip[4])
+{
+	esp_netif_ip_info_t info = { 0 };
+	esp_netif_t *netif = esp_netif_get_handle_from_ifkey("WIFI_STA_DEF");
+	if (netif) esp_netif_get_ip_info(netif, &info);
+	memcpy(ip, &info.ip.addr, 4);
+}
+
+void mdns_capture_packet(const uint8_t src_ip[4], uint16_t src_port,
+	const uint8_t dst_ip[4], uint16_t dst_port,
+	const uint8_t *payload, size_t len)
+{
+	if (!s_capture.rb) return;
+
+	uint8_t self[4];
+	if (!src_ip || !dst_ip) local_ip(self);
+	if (!src_ip) src_ip = self;
+	if (!dst_ip) dst_ip = self;
+	uint8_t *item = NULL;
+	if (xRingbufferSendAcquire(s_capture.rb, (void **)&item, MDNS_PCAP_RECORD_LEN(len), 0) != pdTRUE) {
+		s_capture.dropped++;
+		return;
+	}
+	mdns_pcap_record(item, esp_timer_get_time(), src_ip, src_port, dst_ip, dst_port, payload, len);
+	xRingbufferSendComplete(s_capture.rb, item);
+	s_capture.captured++;
+}
+
+static bool send_all(int sock, const uint8_t *buf, size_t len)
+{
+	while (len) {
+		int n = send(sock, buf, len, 0);
+		if (n <= 0) return false;
+		buf += n;
+		len -= n;
+	}
+	return true;
+}
+
+static void capture_task(void *arg)
+{
+	struct sockaddr_in to = {
+		.sin_family = AF_INET,
+		.sin_port = htons(CONFIG_MDNS_CAPTURE_PORT),
+		.sin_addr.s_addr = inet_addr(CONFIG_MDNS_CAPTURE_HOST),
+	};
+
+	while (1) {
+		int sock = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+		if (sock < 0 || connect(sock, (struct sockaddr *)&to, sizeof(to)) != 0) {
+			ESP_LOGW(TAG, "cannot connect to %s:%d, errno %d", CONFIG_MDNS_CAPTURE_HOST, CONFIG_MDNS_CAPTURE_PORT, errno);
+			if (sock >= 0) close(sock);
+			vTaskDelay(pdMS_TO_TICKS(5000));
+			continue;
+		}
+		ESP_LOGI(TAG, "streaming capture to %s:%d", CONFIG_MDNS_CAPTURE_HOST, CONFIG_MDNS_CAPTURE_PORT);
+
+		// every connection gets a complete pcap file
+		uint8_t header[MDNS_PCAP_FILE_HEADER_LEN];
+		bool ok = send_all(sock, header, mdns_pcap_file_header(header));
+		while (ok) {
+			size_t size;
+			uint8_t *item = xRingbufferReceive(s_capture.rb, &size, portMAX_DELAY);
+			ok = send_all(sock, item, size);
+			vRingbufferReturnItem(s_capture.rb, item);
+		}
+		ESP_LOGW(TAG, "collector disconnected");
+		close(sock);
+	}
+}
+
+esp_err_t mdns_capture_start(void)
+{
+	if (s_capture.rb) return ESP_ERR_INVALID_STATE;
+	s_capture.rb = xRingbufferCreate(CONFIG_MDNS_CAPTURE_BUFFER_SIZE, RINGBUF_TYPE_NOSPLIT);
+	if (!s_capture.rb) return ESP_ERR_NO_MEM;
+	if (xTaskCreate(capture_task, "CAPTURE", 1024*3, NULL, 2, NULL) != pdPASS) return ESP_ERR_NO_MEM;
+	return ESP_OK;
+}
+
+void mdns_capture_get_stats(uint32_t *captured, uint32_t *dropped)
+{
+	*captured = s_capture.captured;
+	*dropped = s_capture.dropped;
+}
@@ -0,0 +1,16 @@
+/* Component log level
+
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#pragma once
+
+/* Include this instead of esp_log.h, before any other header,
+ * so that messages above CONFIG_MDNS_DISCOVERY_LOG_LEVEL are not compiled in. */
+#include "sdkconfig.h"
+#define LOG_LOCAL_LEVEL CONFIG_MDNS_DISCOVERY_LOG_LEVEL
+#include "esp_log.h"
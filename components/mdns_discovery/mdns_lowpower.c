@@ -0,0 +1,182 @@
+/* Duty-cycled low-power discovery
+
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#include "mdns_log.h"
+#include <inttypes.h>
+#include <string.h>
+#include <sys/time.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "esp_idf_version.h"
+#include "esp_random.h"
+#include "esp_timer.h"
+#include "esp_wifi.h"
+#include "esp_sntp.h"
+#include "mdns.h"
+#include "mdns_lp_schedule.h"
+#include "mdns_lowpower.h"
+
+static const char *TAG = "LOWPOWER";
+
+static struct {
+	mdns_lp_schedule_t schedule;
+	mdns_lp_schedule_t adopted;         // what peers have told us, applied at the next window
+	SemaphoreHandle_t lock;             // guards adopted, which the watcher task updates
+	volatile bool joined;               // an established peer's phase was seen, or the join time ran out
+	volatile bool synced;               // SNTP has set the clock
+	int64_t join_until_us;              // look for peers until then, both before and after SNTP has set the clock
+	char service[32];
+	char proto[8];
+} s_lp;
+
+static int64_t now_ms(void)
+{
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return (int64_t)tv.tv_sec * 1000 + tv.tv_usec / 1000;
+}
+
+static void start_sntp(void)
+{
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 1, 0)
+	esp_sntp_setoperatingmode(ESP_SNTP_OPMODE_POLL);
+	esp_sntp_setservername(0, CONFIG_MDNS_LP_NTP_SERVER);
+	esp_sntp_init();
+#else
+	sntp_setoperatingmode(SNTP_OPMODE_POLL);
+	sntp_setservername(0, CONFIG_MDNS_LP_NTP_SERVER);
+	sntp_init();
+#endif
+}
+
+/* Window times are only shared with peers once SNTP has set the clock */
+static bool clock_synced(void)
+{
+	if (s_lp.synced) return true;
+	if (sntp_get_sync_status() != SNTP_SYNC_STATUS_COMPLETED) return false;
+	// the status is reset once read, so remember it
+	s_lp.synced = true;
+	s_lp.join_until_us = esp_timer_get_time() + (int64_t)CONFIG_MDNS_LP_JOIN_TIME * 1000;
+	ESP_LOGI(TAG, "clock set by SNTP");
+	return true;
+}
+
+static void advertise(void)
+{
+	char value[24];
+	mdns_lp_format_txt(&s_lp.schedule, value, sizeof(value));
+	esp_err_t err = mdns_service_txt_item_set(s_lp.service, s_lp.proto, MDNS_LP_TXT_KEY, value);
+	if (err != ESP_OK) {
+		ESP_LOGW(TAG, "cannot set TXT %s=%s: %s", MDNS_LP_TXT_KEY, value, esp_err_to_name(err));
+	}
+}
+
+/* Take over the phase and joining state staged by the watcher task, and advertise them if they changed */
+static void apply_adopted(void)
+{
+	xSemaphoreTake(s_lp.lock, portMAX_DELAY);
+	mdns_lp_schedule_t adopted = s_lp.adopted;
+	xSemaphoreGive(s_lp.lock);
+	if (adopted.phase_ms == s_lp.schedule.phase_ms && adopted.joining == s_lp.schedule.joining) return;
+	if (adopted.phase_ms != s_lp.schedule.phase_ms) {
+		ESP_LOGI(TAG, "adopted window phase %"PRIu32" ms", adopted.phase_ms);
+	}
+	s_lp.schedule = adopted;
+	advertise();
+}
+
+/* A new node keeps the radio on until its clock is set, and then until it hears the window phase
+ * of an established peer, since its own windows are unlikely to overlap theirs. */
+static bool joining(void)
+{
+	if (!clock_synced()) return true;
+	if (!s_lp.joined && esp_timer_get_time() >= s_lp.join_until_us) {
+		ESP_LOGW(TAG, "no established peer seen, keeping phase %"PRIu32" ms", s_lp.schedule.phase_ms);
+		s_lp.joined = true;
+	}
+	if (!s_lp.joined) return true;
+	// from now on only established peers move our phase
+	xSemaphoreTake(s_lp.lock, portMAX_DELAY);
+	s_lp.adopted.joining = false;
+	xSemaphoreGive(s_lp.lock);
+	return false;
+}
+
+static void lowpower_task(void *arg)
+{
+	esp_wifi_set_ps(WIFI_PS_NONE);
+	while (joining()) {
+		// nodes that join together agree on the lowest of their phases
+		apply_adopted();
+		vTaskDelay(pdMS_TO_TICKS(100));
+	}
+
+	while (1) {
+		// phase changes and the announcement they cause wait for the window
+		apply_adopted();
+
+		int64_t now = now_ms();
+		int64_t start = mdns_lp_window_start(&s_lp.schedule, now);
+		if (mdns_lp_in_window(&s_lp.schedule, now)) {
+			esp_wifi_set_ps(WIFI_PS_NONE);
+			vTaskDelay(pdMS_TO_TICKS(start + s_lp.schedule.window_ms - now));
+		} else {
+			esp_wifi_set_ps(WIFI_PS_MAX_MODEM);
+			vTaskDelay(pdMS_TO_TICKS(start - now));
+		}
+	}
+}
+
+esp_err_t mdns_lowpower_start(const char *service, const char *proto)
+{
+	strlcpy(s_lp.service, service, sizeof(s_lp.service));
+	strlcpy(s_lp.proto, proto, sizeof(s_lp.proto));
+	s_lp.schedule.period_ms = CONFIG_MDNS_LP_PERIOD;
+	s_lp.schedule.window_ms = CONFIG_MDNS_LP_WINDOW;
+	s_lp.schedule.phase_ms = esp_random() % CONFIG_MDNS_LP_PERIOD;
+	s_lp.schedule.joining = true;
+	s_lp.adopted = s_lp.schedule;
+	s_lp.lock = xSemaphoreCreateMutex();
+	if (!s_lp.lock) return ESP_ERR_NO_MEM;
+	s_lp.join_until_us = esp_timer_get_time() + (int64_t)CONFIG_MDNS_LP_JOIN_TIME * 1000;
+
+	start_sntp();
+	ESP_LOGI(TAG, "radio stays on until SNTP sets the clock from %s", CONFIG_MDNS_LP_NTP_SERVER);
+	advertise();
+	ESP_LOGI(TAG, "%"PRIu32" ms window every %"PRIu32" ms, phase %"PRIu32" ms",
+		s_lp.schedule.window_ms, s_lp.schedule.period_ms, s_lp.schedule.phase_ms);
+	if (xTaskCreate(lowpower_task, "LOWPOWER", 1024*3, NULL, 5, NULL) != pdPASS) return ESP_ERR_NO_MEM;
+	return ESP_OK;
+}
+
+int64_t mdns_lowpower_delay_us(void)
+{
+	if (!s_lp.schedule.period_ms || !s_lp.synced || !s_lp.joined) return 0;
+	int64_t now = now_ms();
+	return (mdns_lp_window_start(&s_lp.schedule, now) - now) * 1000;
+}
+
+uint32_t mdns_lowpower_join_interval_ms(void)
+{
+	if (!s_lp.schedule.period_ms || s_lp.joined || esp_timer_get_time() >= s_lp.join_until_us) return 0;
+	return mdns_lp_join_interval(&s_lp.schedule);
+}
+
+void mdns_lowpower_ingest(const uint8_t *buf, size_t len)
+{
+	uint32_t phase;
+	bool joining;
+	if (!s_lp.schedule.period_ms) return;
+	if (!mdns_lp_find_phase(&s_lp.schedule, buf, len, &phase, &joining)) return;
+	xSemaphoreTake(s_lp.lock, portMAX_DELAY);
+	mdns_lp_adopt_phase(&s_lp.adopted, phase, joining);
+	xSemaphoreGive(s_lp.lock);
+	if (!joining) s_lp.joined = true;
+}
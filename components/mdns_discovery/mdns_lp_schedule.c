@@ -0,0 +1,103 @@
+/* Wake window schedule for low-power discovery
+
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "mdns_pkt.h"
+#include "mdns_lp_schedule.h"
+
+/* Offset of now_ms into the current period, counted from the window start */
+static int64_t offset(const mdns_lp_schedule_t *s, int64_t now_ms)
+{
+	int64_t o = (now_ms - s->phase_ms) % s->period_ms;
+	return o < 0 ? o + s->period_ms : o;
+}
+
+bool mdns_lp_in_window(const mdns_lp_schedule_t *s, int64_t now_ms)
+{
+	return offset(s, now_ms) < s->window_ms;
+}
+
+int64_t mdns_lp_window_start(const mdns_lp_schedule_t *s, int64_t now_ms)
+{
+	int64_t o = offset(s, now_ms);
+	if (o < s->window_ms) return now_ms - o;
+	return now_ms - o + s->period_ms;
+}
+
+uint32_t mdns_lp_join_interval(const mdns_lp_schedule_t *s)
+{
+	return s->window_ms > 1 ? s->window_ms / 2 : 1;
+}
+
+bool mdns_lp_adopt_phase(mdns_lp_schedule_t *s, uint32_t peer_phase_ms, bool peer_joining)
+{
+	if (s->joining == peer_joining) {
+		if (peer_phase_ms >= s->phase_ms) return false;
+	} else {
+		if (peer_joining || peer_phase_ms == s->phase_ms) return false;
+	}
+	s->phase_ms = peer_phase_ms;
+	return true;
+}
+
+void mdns_lp_format_txt(const mdns_lp_schedule_t *s, char *out, size_t size)
+{
+	snprintf(out, size, "%lu:%lu%s", (unsigned long)s->period_ms, (unsigned long)s->phase_ms, s->joining ? ":j" : "");
+}
+
+/* Parse "<period>:<phase>" or "<period>:<phase>:j" */
+static bool parse_value(const uint8_t *v, size_t len, uint32_t *period, uint32_t *phase, bool *joining)
+{
+	char buf[24];
+	if (len == 0 || len >= sizeof(buf)) return false;
+	memcpy(buf, v, len);
+	buf[len] = 0;
+	char *end;
+	unsigned long p = strtoul(buf, &end, 10);
+	if (*end != ':') return false;
+	unsigned long f = strtoul(end + 1, &end, 10);
+	if (p == 0 || f >= p) return false;
+	if (*end && strcmp(end, ":j") != 0) return false;
+	*period = p;
+	*phase = f;
+	*joining = *end != 0;
+	return true;
+}
+
+bool mdns_lp_find_phase(const mdns_lp_schedule_t *s, const uint8_t *buf, size_t len, uint32_t *phase_ms, bool *joining)
+{
+	static const size_t key_len = sizeof(MDNS_LP_TXT_KEY) - 1;
+	mdns_pkt_parser_t p;
+	mdns_pkt_rr_t rr;
+	bool found = false;
+
+	if (!mdns_pkt_parser_init(&p, buf, len)) return false;
+	while (mdns_pkt_parser_next(&p, &rr)) {
+		if (rr.type != MDNS_PKT_TYPE_TXT || rr.ttl == 0) continue;
+		// TXT rdata is a sequence of length prefixed "key=value" strings
+		for (size_t i = 0; i < rr.rdlen; i += 1 + rr.rdata[i]) {
+			size_t l = rr.rdata[i];
+			const uint8_t *item = rr.rdata + i + 1;
+			if (i + 1 + l > rr.rdlen) break;
+			if (l <= key_len || memcmp(item, MDNS_LP_TXT_KEY "=", key_len + 1) != 0) continue;
+			uint32_t period, phase;
+			bool j;
+			if (!parse_value(item + key_len + 1, l - key_len - 1, &period, &phase, &j)) continue;
+			if (period != s->period_ms) continue;
+			// established peers first, then the lowest phase
+			if (found && (j != *joining ? j : phase >= *phase_ms)) continue;
+			*phase_ms = phase;
+			*joining = j;
+			found = true;
+		}
+	}
+	return found;
+}
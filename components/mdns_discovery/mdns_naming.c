@@ -0,0 +1,209 @@
+/* Conflict-aware mDNS hostname
+
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#include "mdns_log.h"
+#include <stdio.h>
+#include <inttypes.h>
+#include <string.h>
+#include "esp_idf_version.h"
+#include "esp_mac.h" // esp_read_mac
+#include "esp_timer.h"
+#include "mdns.h"
+#include "mdns_naming.h"
+
+static const char *TAG = "NAMING";
+
+#define HOSTNAME_MAX    64
+/* mDNS probes a name three times, 250 ms apart, before it announces it (RFC 6762 section 8.1),
+ * so a name that has not changed for this long has outlived the probe */
+#define STABLE_US       (1000 * 1000)
+
+static struct {
+	char requested[HOSTNAME_MAX];
+	char prefix[HOSTNAME_MAX];
+	char current[HOSTNAME_MAX];
+	int index;              // candidate number of current
+	bool claimed;           // current outlived the mDNS probe
+	int64_t start_us;       // mdns_naming_set_hostname() was called
+	int64_t set_us;         // current was set, or a rename by mDNS was seen
+	mdns_naming_cb_t cb;
+	void *ctx;
+	esp_timer_handle_t timer;
+#if CONFIG_MDNS_DISCOVERY_METRICS
+	mdns_naming_metrics_t metrics;
+#endif
+} s_naming;
+
+/* Build candidate number index, see mdns_naming_set_hostname() */
+static void candidate(int index, const char *requested, const char *prefix, char *out)
+{
+	if (index == 0) {
+		strlcpy(out, requested, HOSTNAME_MAX);
+		return;
+	}
+	uint8_t mac[6];
+	esp_read_mac(mac, ESP_MAC_WIFI_STA);
+	if (index == 1) {
+		snprintf(out, HOSTNAME_MAX, "%s-%02X%02X%02X%02X%02X%02X",
+			prefix, mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
+	} else {
+		snprintf(out, HOSTNAME_MAX, "%s-%02X%02X%02X%02X%02X%02X-%d",
+			prefix, mac[0], mac[1], mac[2], mac[3], mac[4], mac[5], index);
+	}
+}
+
+#if CONFIG_MDNS_PREPROBE
+static mdns_search_once_t *query_async(const char *name, uint16_t type)
+{
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 0, 0)
+	return mdns_query_async_new(name, NULL, NULL, type, CONFIG_MDNS_PREPROBE_TIMEOUT, 1, NULL);
+#else
+	return mdns_query_async_new(name, NULL, NULL, type, CONFIG_MDNS_PREPROBE_TIMEOUT, 1);
+#endif
+}
+
+/* Wait for a search to end, at its first answer or its timeout, and free it.
+ * Returns true if it was answered. */
+static bool answered(mdns_search_once_t *search, const char *name)
+{
+	mdns_result_t *results = NULL;
+	if (!search) return false;
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 0, 0)
+	while (!mdns_query_async_get_results(search, CONFIG_MDNS_PREPROBE_TIMEOUT, &results, NULL)) {}
+#else
+	while (!mdns_query_async_get_results(search, CONFIG_MDNS_PREPROBE_TIMEOUT, &results)) {}
+#endif
+	bool found = results != NULL;
+	const mdns_ip_addr_t *a = found ? results->addr : NULL;
+	if (a && a->addr.type == ESP_IPADDR_TYPE_V4) {
+		ESP_LOGW(TAG, "%s.local is taken by " IPSTR, name, IP2STR(&a->addr.u_addr.ip4));
+	} else if (a) {
+		ESP_LOGW(TAG, "%s.local is taken by " IPV6STR, name, IPV62STR(a->addr.u_addr.ip6));
+	}
+	mdns_query_results_free(results);
+	mdns_query_async_delete(search);
+	return found;
+}
+
+/* Returns true if another node answers for name with an A or AAAA record.
+ * Both queries run at the same time, so a free name costs one timeout. */
+static bool name_taken(const char *name)
+{
+	mdns_search_once_t *a = query_async(name, MDNS_TYPE_A);
+	mdns_search_once_t *aaaa = query_async(name, MDNS_TYPE_AAAA);
+	// both searches must end before they are freed, so always wait for the second one
+	bool taken = answered(a, name);
+	if (answered(aaaa, name)) taken = true;
+	return taken;
+}
+#endif
+
+/* Set candidate number index as hostname. mDNS probes it before it is claimed. */
+static esp_err_t claim(int index)
+{
+	char name[HOSTNAME_MAX];
+	candidate(index, s_naming.requested, s_naming.prefix, name);
+	esp_err_t err = mdns_hostname_set(name);
+	if (err != ESP_OK) return err;
+	s_naming.index = index;
+	s_naming.set_us = esp_timer_get_time();
+	s_naming.claimed = false;
+	strlcpy(s_naming.current, name, HOSTNAME_MAX);
+	if (strcmp(name, s_naming.requested) != 0 && s_naming.cb) s_naming.cb(s_naming.requested, name, s_naming.ctx);
+	return ESP_OK;
+}
+
+static void check_renamed(void *arg)
+{
+	char actual[HOSTNAME_MAX];
+	if (mdns_hostname_get(actual) != ESP_OK) return;
+	int64_t now = esp_timer_get_time();
+
+	if (strcmp(actual, s_naming.current) != 0) {
+		// mDNS lost a conflict and renamed us
+		ESP_LOGW(TAG, "hostname changed from [%s] to [%s]", s_naming.current, actual);
+#if CONFIG_MDNS_DISCOVERY_METRICS
+		s_naming.metrics.conflicts++;
+#endif
+		// Nodes that boot together pre-probe the requested name before either claims it, and one
+		// of them loses the mDNS probe. Move it to its MAC based name, which no other node uses.
+		if (s_naming.index == 0 && claim(1) == ESP_OK) return;
+		strlcpy(s_naming.current, actual, HOSTNAME_MAX);
+		s_naming.set_us = now;
+		s_naming.claimed = false;
+		if (s_naming.cb) s_naming.cb(s_naming.requested, actual, s_naming.ctx);
+		return;
+	}
+
+	if (!s_naming.claimed && now - s_naming.set_us >= STABLE_US) {
+		s_naming.claimed = true;
+		int64_t settle_us = s_naming.set_us - s_naming.start_us;
+		ESP_LOGI(TAG, "[%s] unchanged since %"PRId64" ms after it was requested", s_naming.current, settle_us / 1000);
+#if CONFIG_MDNS_DISCOVERY_METRICS
+		s_naming.metrics.settle_us = settle_us;
+#endif
+	}
+}
+
+esp_err_t mdns_naming_set_hostname(const char *requested, const char *prefix, mdns_naming_cb_t cb, void *ctx)
+{
+	strlcpy(s_naming.requested, requested, HOSTNAME_MAX);
+	strlcpy(s_naming.prefix, prefix, HOSTNAME_MAX);
+	s_naming.cb = cb;
+	s_naming.ctx = ctx;
+	s_naming.start_us = esp_timer_get_time();
+
+	int index = 0;
+#if CONFIG_MDNS_PREPROBE
+	char name[HOSTNAME_MAX];
+	int conflicts = 0;
+	for (index = 0; ; index++) {
+		candidate(index, requested, prefix, name);
+		if (!name_taken(name)) break;
+		conflicts++;
+		if (index + 1 == CONFIG_MDNS_NAMING_MAX_CANDIDATES) {
+			ESP_LOGE(TAG, "all %d candidate names are taken, leaving the conflict on [%s] to mDNS", index + 1, name);
+			break;
+		}
+	}
+	int64_t preprobe_us = esp_timer_get_time() - s_naming.start_us;
+	ESP_LOGI(TAG, "probed %d names in %"PRId64" ms, %d conflicts", index + 1, preprobe_us / 1000, conflicts);
+#if CONFIG_MDNS_DISCOVERY_METRICS
+	s_naming.metrics.preprobe_us += preprobe_us;
+	s_naming.metrics.probes += index + 1;
+	s_naming.metrics.conflicts += conflicts;
+#endif
+#endif
+
+	esp_err_t err = claim(index);
+	if (err != ESP_OK) return err;
+
+	if (!s_naming.timer) {
+		const esp_timer_create_args_t args = {
+			.callback = check_renamed,
+			.name = "naming",
+		};
+		err = esp_timer_create(&args, &s_naming.timer);
+		if (err != ESP_OK) return err;
+		err = esp_timer_start_periodic(s_naming.timer, (uint64_t)CONFIG_MDNS_NAMING_CHECK_INTERVAL * 1000);
+	}
+	return err;
+}
+
+esp_err_t mdns_naming_get_hostname(char *buf)
+{
+	return mdns_hostname_get(buf);
+}
+
+#if CONFIG_MDNS_DISCOVERY_METRICS
+void mdns_naming_get_metrics(mdns_naming_metrics_t *metrics)
+{
+	*metrics = s_naming.metrics;
+}
+#endif
@@ -0,0 +1,183 @@
+/* pcap writer/reader for mDNS traffic
+
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#include <string.h>
+#include "mdns_pcap.h"
+
+#define MAGIC_US        0xA1B2C3D4
+#define MAGIC_NS        0xA1B23C4D
+#define SNAPLEN         65535
+#define MDNS_PORT       5353
+
+#define LINKTYPE_ETHERNET   1
+#define LINKTYPE_RAW        101
+#define LINKTYPE_LINUX_SLL  113
+#define LINKTYPE_IPV4       228
+
+static void put_le32(uint8_t *p, uint32_t v)
+{
+	p[0] = v; p[1] = v >> 8; p[2] = v >> 16; p[3] = v >> 24;
+}
+
+static void put_le16(uint8_t *p, uint16_t v)
+{
+	p[0] = v; p[1] = v >> 8;
+}
+
+static void put_be16(uint8_t *p, uint16_t v)
+{
+	p[0] = v >> 8; p[1] = v;
+}
+
+static uint16_t get_be16(const uint8_t *p)
+{
+	return (uint16_t)((p[0] << 8) | p[1]);
+}
+
+static uint32_t get_u32(const mdns_pcap_reader_t *r, const uint8_t *p)
+{
+	if (r->swapped) return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+	return ((uint32_t)p[3] << 24) | ((uint32_t)p[2] << 16) | ((uint32_t)p[1] << 8) | p[0];
+}
+
+size_t mdns_pcap_file_header(uint8_t *out)
+{
+	put_le32(out, MAGIC_US);
+	put_le16(out + 4, 2);       // version 2.4
+	put_le16(out + 6, 4);
+	put_le32(out + 8, 0);       // thiszone
+	put_le32(out + 12, 0);      // sigfigs
+	put_le32(out + 16, SNAPLEN);
+	put_le32(out + 20, LINKTYPE_RAW);
+	return MDNS_PCAP_FILE_HEADER_LEN;
+}
+
+static uint16_t ip_checksum(const uint8_t *p, size_t len)
+{
+	uint32_t sum = 0;
+	for (size_t i = 0; i < len; i += 2) sum += get_be16(p + i);
+	while (sum >> 16) sum = (sum & 0xFFFF) + (sum >> 16);
+	return (uint16_t)~sum;
+}
+
+size_t mdns_pcap_record(uint8_t *out, int64_t ts_us,
+	const uint8_t src_ip[4], uint16_t src_port,
+	const uint8_t dst_ip[4], uint16_t dst_port,
+	const uint8_t *payload, size_t len)
+{
+	uint32_t caplen = MDNS_PCAP_IP_UDP_LEN + len;
+	put_le32(out, (uint32_t)(ts_us / 1000000));
+	put_le32(out + 4, (uint32_t)(ts_us % 1000000));
+	put_le32(out + 8, caplen);
+	put_le32(out + 12, caplen);
+
+	uint8_t *ip = out + MDNS_PCAP_RECORD_HEADER_LEN;
+	memset(ip, 0, 20);
+	ip[0] = 0x45;
+	put_be16(ip + 2, caplen);
+	ip[8] = 255;                // mDNS uses TTL 255
+	ip[9] = 17;                 // UDP
+	memcpy(ip + 12, src_ip, 4);
+	memcpy(ip + 16, dst_ip, 4);
+	put_be16(ip + 10, ip_checksum(ip, 20));
+
+	uint8_t *udp = ip + 20;
+	put_be16(udp, src_port);
+	put_be16(udp + 2, dst_port);
+	put_be16(udp + 4, 8 + len);
+	put_be16(udp + 6, 0);       // no checksum
+	memcpy(udp + 8, payload, len);
+	return MDNS_PCAP_RECORD_LEN(len);
+}
+
+bool mdns_pcap_reader_init(mdns_pcap_reader_t *r, const uint8_t *buf, size_t len)
+{
+	if (len < MDNS_PCAP_FILE_HEADER_LEN) return false;
+	memset(r, 0, sizeof(*r));
+	r->buf = buf;
+	r->len = len;
+
+	uint32_t magic = get_u32(r, buf);
+	if (magic != MAGIC_US && magic != MAGIC_NS) {
+		r->swapped = true;
+		magic = get_u32(r, buf);
+		if (magic != MAGIC_US && magic != MAGIC_NS) return false;
+	}
+	r->nanosecond = magic == MAGIC_NS;
+	r->linktype = get_u32(r, buf + 20) & 0xFFFF;
+	r->pos = MDNS_PCAP_FILE_HEADER_LEN;
+	return r->linktype == LINKTYPE_ETHERNET || r->linktype == LINKTYPE_RAW
+		|| r->linktype == LINKTYPE_LINUX_SLL || r->linktype == LINKTYPE_IPV4;
+}
+
+/* Return the offset of the IPv4 header in a frame, or -1 if the frame is not IPv4 */
+static int ip_offset(const mdns_pcap_reader_t *r, const uint8_t *frame, size_t len)
+{
+	switch (r->linktype) {
+	case LINKTYPE_ETHERNET: {
+		size_t off = 12;
+		if (len >= off + 2 && get_be16(frame + off) == 0x8100) off += 4;   // 802.1Q tag
+		if (len < off + 2 || get_be16(frame + off) != 0x0800) return -1;
+		return off + 2;
+	}
+	case LINKTYPE_LINUX_SLL:
+		if (len < 16 || get_be16(frame + 14) != 0x0800) return -1;
+		return 16;
+	default:
+		return 0;
+	}
+}
+
+static bool parse_frame(const mdns_pcap_reader_t *r, const uint8_t *frame, size_t len, mdns_pcap_packet_t *pkt)
+{
+	int off = ip_offset(r, frame, len);
+	if (off < 0 || len < (size_t)off + 20) return false;
+	const uint8_t *ip = frame + off;
+	len -= off;
+
+	size_t ihl = (ip[0] & 0x0F) * 4;
+	if ((ip[0] >> 4) != 4 || ihl < 20 || len < ihl + 8 || ip[9] != 17) return false;
+	if (get_be16(ip + 6) & 0x3FFF) return false;   // fragment
+	size_t total = get_be16(ip + 2);
+	if (total < ihl + 8) return false;
+	if (total < len) len = total;
+
+	const uint8_t *udp = ip + ihl;
+	size_t udp_len = get_be16(udp + 4);
+	if (udp_len < 8 || ihl + udp_len > len) return false;
+
+	memcpy(pkt->src_ip, ip + 12, 4);
+	memcpy(pkt->dst_ip, ip + 16, 4);
+	pkt->src_port = get_be16(udp);
+	pkt->dst_port = get_be16(udp + 2);
+	pkt->payload = udp + 8;
+	pkt->len = udp_len - 8;
+	return pkt->src_port == MDNS_PORT || pkt->dst_port == MDNS_PORT;
+}
+
+bool mdns_pcap_reader_next(mdns_pcap_reader_t *r, mdns_pcap_packet_t *pkt)
+{
+	while (r->pos + MDNS_PCAP_RECORD_HEADER_LEN <= r->len) {
+		const uint8_t *h = r->buf + r->pos;
+		uint32_t sec = get_u32(r, h);
+		uint32_t frac = get_u32(r, h + 4);
+		uint32_t caplen = get_u32(r, h + 8);
+		const uint8_t *frame = h + MDNS_PCAP_RECORD_HEADER_LEN;
+		if (caplen > r->len - r->pos - MDNS_PCAP_RECORD_HEADER_LEN) {
+			// truncated capture
+			r->pos = r->len;
+			return false;
+		}
+		r->pos += MDNS_PCAP_RECORD_HEADER_LEN + caplen;
+
+		pkt->ts_us = (int64_t)sec * 1000000 + (r->nanosecond ? frac / 1000 : frac);
+		if (parse_frame(r, frame, caplen, pkt)) return true;
+	}
+	return false;
+}
@@ -0,0 +1,319 @@
+/* Peer table fed from mDNS responses
+
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#include <string.h>
+#include <strings.h>
+#include <ctype.h>
+#include "mdns_pkt.h"
+#include "mdns_peers.h"
+
+#define LOCAL_SUFFIX ".local"
+
+static uint32_t hash_str(uint32_t h, const char *s)
+{
+	// FNV-1a, case insensitive because DNS names are
+	while (*s) {
+		h ^= (uint8_t)tolower((unsigned char)*s++);
+		h *= 16777619u;
+	}
+	// hash the terminator too, so "ab"+"c" and "a"+"bc" differ
+	return h * 16777619u;
+}
+
+static uint32_t peer_key(const char *instance, const char *service, const char *proto)
+{
+	uint32_t h = 2166136261u;
+	h = hash_str(h, instance);
+	h = hash_str(h, service);
+	return hash_str(h, proto);
+}
+
+static bool copy_str(char *dst, size_t size, const char *src, size_t len)
+{
+	if (len >= size) return false;
+	memcpy(dst, src, len);
+	dst[len] = 0;
+	return true;
+}
+
+/* Strip ".local" from a name in place.
+ * Returns false if the name is not in the local domain. */
+static bool strip_local(char *name)
+{
+	size_t n = strlen(name);
+	size_t s = strlen(LOCAL_SUFFIX);
+	if (n <= s || strcasecmp(name + n - s, LOCAL_SUFFIX) != 0) return false;
+	name[n - s] = 0;
+	return true;
+}
+
+/* Split "<service>.<proto>.local" */
+static bool split_service(const char *name, char *service, char *proto)
+{
+	char buf[MDNS_PKT_NAME_MAX];
+	strcpy(buf, name);
+	if (!strip_local(buf)) return false;
+	char *dot = strrchr(buf, '.');
+	if (!dot || strchr(buf, '.') != dot) return false;
+	return copy_str(service, MDNS_PEER_SERVICE_MAX, buf, dot - buf)
+		&& copy_str(proto, MDNS_PEER_PROTO_MAX, dot + 1, strlen(dot + 1));
+}
+
+/* Split "<instance>.<service>.<proto>.local". The instance label may itself contain dots. */
+static bool split_instance(const char *name, char *instance, char *service, char *proto)
+{
+	char buf[MDNS_PKT_NAME_MAX];
+	strcpy(buf, name);
+	if (!strip_local(buf)) return false;
+	char *p = strrchr(buf, '.');
+	if (!p) return false;
+	*p = 0;
+	char *s = strrchr(buf, '.');
+	if (!s) return false;
+	*s = 0;
+	return copy_str(instance, MDNS_PEER_INSTANCE_MAX, buf, strlen(buf))
+		&& copy_str(service, MDNS_PEER_SERVICE_MAX, s + 1, strlen(s + 1))
+		&& copy_str(proto, MDNS_PEER_PROTO_MAX, p + 1, strlen(p + 1));
+}
+
+static void notify(mdns_peer_table_t *t, const mdns_peer_t *peer, mdns_peer_event_t event)
+{
+	if (t->cb) t->cb(peer, event, t->ctx);
+}
+
+static void remove_slot(mdns_peer_table_t *t, mdns_peer_t *peer)
+{
+	notify(t, peer, MDNS_PEER_REMOVED);
+	peer->used = false;
+	t->count--;
+}
+
+static void touch(const mdns_peer_table_t *t, mdns_peer_t *peer, uint32_t ttl, int64_t now_us)
+{
+	if (ttl < t->min_ttl) ttl = t->min_ttl;
+	int64_t expires = now_us + (int64_t)ttl * 1000000;
+	if (expires > peer->expires_us) peer->expires_us = expires;
+	peer->last_seen_us = now_us;
+}
+
+void mdns_peer_table_init(mdns_peer_table_t *t, mdns_peer_t *slots, size_t size,
+	mdns_peer_filter_t filter, mdns_peer_cb_t cb, void *ctx)
+{
+	memset(slots, 0, size * sizeof(mdns_peer_t));
+	t->slots = slots;
+	t->size = size;
+	t->count = 0;
+	t->min_ttl = 0;
+	t->filter = filter;
+	t->cb = cb;
+	t->ctx = ctx;
+#if CONFIG_MDNS_DISCOVERY_METRICS
+	memset(&t->metrics, 0, sizeof(t->metrics));
+#endif
+}
+
+mdns_peer_t *mdns_peer_table_find(mdns_peer_table_t *t, const char *instance, const char *service, const char *proto)
+{
+	uint32_t key = peer_key(instance, service, proto);
+	for (size_t i = 0; i < t->size; i++) {
+		mdns_peer_t *peer = &t->slots[i];
+		if (peer->used && peer->key == key
+			&& strcasecmp(peer->instance, instance) == 0
+			&& strcasecmp(peer->service, service) == 0
+			&& strcasecmp(peer->proto, proto) == 0) {
+			return peer;
+		}
+	}
+	return NULL;
+}
+
+static mdns_peer_t *peer_alloc(mdns_peer_table_t *t, const char *instance, const char *service, const char *proto)
+{
+	for (size_t i = 0; i < t->size; i++) {
+		mdns_peer_t *peer = &t->slots[i];
+		if (peer->used) continue;
+		memset(peer, 0, sizeof(*peer));
+		peer->used = true;
+		peer->key = peer_key(instance, service, proto);
+		strcpy(peer->instance, instance);
+		strcpy(peer->service, service);
+		strcpy(peer->proto, proto);
+		t->count++;
+		return peer;
+	}
+	return NULL;
+}
+
+static int ingest_ptr(mdns_peer_table_t *t, const mdns_pkt_rr_t *rr, int64_t now_us)
+{
+	char service[MDNS_PEER_SERVICE_MAX], proto[MDNS_PEER_PROTO_MAX];
+	char instance[MDNS_PEER_INSTANCE_MAX], service2[MDNS_PEER_SERVICE_MAX], proto2[MDNS_PEER_PROTO_MAX];
+
+	if (!split_service(rr->name, service, proto)) return 0;
+	if (t->filter && !t->filter(service, proto, t->ctx)) return 0;
+	if (!split_instance(rr->target, instance, service2, proto2)) return 0;
+
+	mdns_peer_t *peer = mdns_peer_table_find(t, instance, service, proto);
+	if (rr->ttl == 0) {
+		// goodbye packet
+		if (peer) remove_slot(t, peer);
+		return 0;
+	}
+	if (peer) {
+		touch(t, peer, rr->ttl, now_us);
+		return 0;
+	}
+	peer = peer_alloc(t, instance, service, proto);
+	if (!peer) {
+#if CONFIG_MDNS_DISCOVERY_METRICS
+		t->metrics.full++;
+#endif
+		return 0;
+	}
+	touch(t, peer, rr->ttl, now_us);
+	notify(t, peer, MDNS_PEER_ADDED);
+	return 1;
+}
+
+static int ingest_srv(mdns_peer_table_t *t, const mdns_pkt_rr_t *rr, int64_t now_us)
+{
+	char instance[MDNS_PEER_INSTANCE_MAX], service[MDNS_PEER_SERVICE_MAX], proto[MDNS_PEER_PROTO_MAX];
+	char hostname[MDNS_PKT_NAME_MAX];
+
+	if (!split_instance(rr->name, instance, service, proto)) return 0;
+	mdns_peer_t *peer = mdns_peer_table_find(t, instance, service, proto);
+	if (!peer || rr->ttl == 0) return 0;
+
+	strcpy(hostname, rr->target);
+	if (!strip_local(hostname) || strlen(hostname) >= MDNS_PEER_HOSTNAME_MAX) return 0;
+	touch(t, peer, rr->ttl, now_us);
+	if (peer->port == rr->port && strcasecmp(peer->hostname, hostname) == 0) return 0;
+	peer->port = rr->port;
+	strcpy(peer->hostname, hostname);
+	notify(t, peer, MDNS_PEER_UPDATED);
+	return 1;
+}
+
+#if CONFIG_MDNS_DISCOVERY_TXT
+static int ingest_txt(mdns_peer_table_t *t, const mdns_pkt_rr_t *rr, int64_t now_us)
+{
+	char instance[MDNS_PEER_INSTANCE_MAX], service[MDNS_PEER_SERVICE_MAX], proto[MDNS_PEER_PROTO_MAX];
+
+	if (!split_instance(rr->name, instance, service, proto)) return 0;
+	mdns_peer_t *peer = mdns_peer_table_find(t, instance, service, proto);
+	if (!peer || rr->ttl == 0) return 0;
+
+	// TXT records live much longer than PTR/SRV, so they do not extend the peer's lifetime
+	peer->last_seen_us = now_us;
+	if (mdns_txt_equal(&peer->txt, rr->rdata, rr->rdlen)) return 0;
+	mdns_txt_set(&peer->txt, rr->rdata, rr->rdlen);
+	notify(t, peer, MDNS_PEER_UPDATED);
+	return 1;
+}
+#endif
+
+#if CONFIG_MDNS_DISCOVERY_A || CONFIG_MDNS_DISCOVERY_AAAA
+static int ingest_addr(mdns_peer_table_t *t, const mdns_pkt_rr_t *rr, int64_t now_us)
+{
+	char hostname[MDNS_PKT_NAME_MAX];
+	int changed = 0;
+
+	if (rr->ttl == 0) return 0;
+	uint8_t len = 0;
+#if CONFIG_MDNS_DISCOVERY_A
+	if (rr->type == MDNS_PKT_TYPE_A) len = 4;
+#endif
+#if CONFIG_MDNS_DISCOVERY_AAAA
+	if (rr->type == MDNS_PKT_TYPE_AAAA) len = 16;
+#endif
+	if (!len || rr->rdlen != len) return 0;
+	strcpy(hostname, rr->name);
+	if (!strip_local(hostname)) return 0;
+
+	for (size_t i = 0; i < t->size; i++) {
+		mdns_peer_t *peer = &t->slots[i];
+		if (!peer->used || strcasecmp(peer->hostname, hostname) != 0) continue;
+#if CONFIG_MDNS_DISCOVERY_A && CONFIG_MDNS_DISCOVERY_AAAA
+		uint8_t *addr = len == 4 ? peer->ip4 : peer->ip6;
+#elif CONFIG_MDNS_DISCOVERY_A
+		uint8_t *addr = peer->ip4;
+#else
+		uint8_t *addr = peer->ip6;
+#endif
+		peer->last_seen_us = now_us;
+		if (memcmp(addr, rr->rdata, len) == 0) continue;
+		memcpy(addr, rr->rdata, len);
+		notify(t, peer, MDNS_PEER_UPDATED);
+		changed++;
+	}
+	return changed;
+}
+#endif
+
+int mdns_peer_table_ingest(mdns_peer_table_t *t, const uint8_t *buf, size_t len, int64_t now_us)
+{
+	mdns_pkt_parser_t p;
+	mdns_pkt_rr_t rr;
+	int changed = 0;
+
+#if CONFIG_MDNS_DISCOVERY_A || CONFIG_MDNS_DISCOVERY_AAAA
+	const int passes = 3;
+#else
+	const int passes = 2;
+#endif
+
+	// Records may come in any order, so PTR creates peers first, then SRV names the host
+	// and TXT sets the attributes, then A/AAAA fill in the address.
+	for (int pass = 0; pass < passes; pass++) {
+		if (!mdns_pkt_parser_init(&p, buf, len)) return 0;
+		while (mdns_pkt_parser_next(&p, &rr)) {
+			if (pass == 0 && rr.type == MDNS_PKT_TYPE_PTR) {
+				changed += ingest_ptr(t, &rr, now_us);
+			} else if (pass == 1 && rr.type == MDNS_PKT_TYPE_SRV) {
+				changed += ingest_srv(t, &rr, now_us);
+#if CONFIG_MDNS_DISCOVERY_TXT
+			} else if (pass == 1 && rr.type == MDNS_PKT_TYPE_TXT) {
+				changed += ingest_txt(t, &rr, now_us);
+#endif
+#if CONFIG_MDNS_DISCOVERY_A || CONFIG_MDNS_DISCOVERY_AAAA
+			} else if (pass == 2) {
+				changed += ingest_addr(t, &rr, now_us);
+#endif
+			}
+#if CONFIG_MDNS_DISCOVERY_METRICS
+			if (pass == 0) t->metrics.records++;
+#endif
+		}
+#if CONFIG_MDNS_DISCOVERY_METRICS
+		if (pass == 0) {
+			t->metrics.packets++;
+			if (p.malformed) t->metrics.malformed++;
+		}
+#endif
+	}
+	return changed;
+}
+
+void mdns_peer_table_expire(mdns_peer_table_t *t, int64_t now_us)
+{
+	for (size_t i = 0; i < t->size; i++) {
+		mdns_peer_t *peer = &t->slots[i];
+		if (peer->used && peer->expires_us <= now_us) remove_slot(t, peer);
+	}
+}
+
+void mdns_peer_table_remove_service(mdns_peer_table_t *t, const char *service, const char *proto)
+{
+	for (size_t i = 0; i < t->size; i++) {
+		mdns_peer_t *peer = &t->slots[i];
+		if (peer->used && strcasecmp(peer->service, service) == 0 && strcasecmp(peer->proto, proto) == 0) {
+			remove_slot(t, peer);
+		}
+	}
+}
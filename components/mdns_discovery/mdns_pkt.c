@@ -0,0 +1,149 @@
+/* Minimal mDNS packet builder/parser
+
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#include <string.h>
+#include "mdns_pkt.h"
+
+#define HEADER_LEN      12
+#define FLAG_QR         0x8000
+#define CLASS_IN        1
+#define CLASS_MASK      0x7FFF
+#define MAX_JUMPS       16
+
+static uint16_t read_u16(const uint8_t *p)
+{
+	return (uint16_t)((p[0] << 8) | p[1]);
+}
+
+static uint32_t read_u32(const uint8_t *p)
+{
+	return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+/* Decode a (possibly compressed) name starting at pos.
+ * Returns the position just after the name in the original stream, or 0 on error.
+ * out may be NULL to only skip the name. */
+static size_t read_name(const uint8_t *buf, size_t len, size_t pos, char *out)
+{
+	size_t end = 0;
+	size_t o = 0;
+	int jumps = 0;
+
+	while (pos < len) {
+		uint8_t l = buf[pos];
+		if (l == 0) {
+			if (!end) end = pos + 1;
+			if (out) out[o] = 0;
+			return end;
+		}
+		if ((l & 0xC0) == 0xC0) {
+			if (pos + 1 >= len || ++jumps > MAX_JUMPS) return 0;
+			if (!end) end = pos + 2;
+			pos = ((l & 0x3F) << 8) | buf[pos + 1];
+			continue;
+		}
+		if (l & 0xC0) return 0;
+		if (pos + 1 + l > len) return 0;
+		if (out) {
+			if (o + l + 2 > MDNS_PKT_NAME_MAX) return 0;
+			if (o) out[o++] = '.';
+			memcpy(out + o, buf + pos + 1, l);
+			o += l;
+		}
+		pos += 1 + l;
+	}
+	return 0;
+}
+
+bool mdns_pkt_parser_init(mdns_pkt_parser_t *p, const uint8_t *buf, size_t len)
+{
+	if (len < HEADER_LEN) return false;
+	p->buf = buf;
+	p->len = len;
+	p->flags = read_u16(buf + 2);
+	p->malformed = false;
+	if (!(p->flags & FLAG_QR)) return false;
+
+	uint16_t qd = read_u16(buf + 4);
+	p->remaining = read_u16(buf + 6) + read_u16(buf + 8) + read_u16(buf + 10);
+	p->pos = HEADER_LEN;
+	for (int i = 0; i < qd; i++) {
+		p->pos = read_name(buf, len, p->pos, NULL);
+		if (!p->pos || p->pos + 4 > len) return false;
+		p->pos += 4;
+	}
+	return true;
+}
+
+bool mdns_pkt_parser_next(mdns_pkt_parser_t *p, mdns_pkt_rr_t *rr)
+{
+	if (!p->remaining) return false;
+	p->remaining--;
+
+	size_t pos = read_name(p->buf, p->len, p->pos, rr->name);
+	if (!pos || pos + 10 > p->len) goto malformed;
+	rr->type = read_u16(p->buf + pos);
+	rr->rclass = read_u16(p->buf + pos + 2) & CLASS_MASK;
+	rr->ttl = read_u32(p->buf + pos + 4);
+	rr->rdlen = read_u16(p->buf + pos + 8);
+	pos += 10;
+	if (pos + rr->rdlen > p->len) goto malformed;
+	rr->rdata = p->buf + pos;
+	rr->target[0] = 0;
+	rr->port = 0;
+
+	if (rr->type == MDNS_PKT_TYPE_PTR) {
+		if (!read_name(p->buf, p->len, pos, rr->target)) goto malformed;
+	} else if (rr->type == MDNS_PKT_TYPE_SRV) {
+		if (rr->rdlen < 7) goto malformed;
+		rr->port = read_u16(rr->rdata + 4);
+		if (!read_name(p->buf, p->len, pos + 6, rr->target)) goto malformed;
+	}
+	p->pos = pos + rr->rdlen;
+	return true;
+
+malformed:
+	p->remaining = 0;
+	p->malformed = true;
+	return false;
+}
+
+size_t mdns_pkt_query_begin(uint8_t *buf, size_t size)
+{
+	if (size < HEADER_LEN) return 0;
+	memset(buf, 0, HEADER_LEN);
+	return HEADER_LEN;
+}
+
+static size_t write_label(uint8_t *buf, size_t len, size_t size, const char *label)
+{
+	size_t l = strlen(label);
+	if (l == 0 || l > 63 || len + 1 + l > size) return 0;
+	buf[len] = (uint8_t)l;
+	memcpy(buf + len + 1, label, l);
+	return len + 1 + l;
+}
+
+size_t mdns_pkt_query_add_ptr(uint8_t *buf, size_t len, size_t size, const char *service, const char *proto)
+{
+	size_t n = write_label(buf, len, size, service);
+	if (n) n = write_label(buf, n, size, proto);
+	if (n) n = write_label(buf, n, size, "local");
+	if (!n || n + 5 > size) return 0;
+	buf[n++] = 0;
+	buf[n++] = 0;
+	buf[n++] = MDNS_PKT_TYPE_PTR;
+	buf[n++] = 0;
+	buf[n++] = CLASS_IN;
+
+	uint16_t qd = read_u16(buf + 4) + 1;
+	buf[4] = qd >> 8;
+	buf[5] = qd & 0xFF;
+	return n;
+}
@@ -0,0 +1,145 @@
+/* One-shot mDNS queries
+
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#include "mdns_log.h"
+#include <stdio.h>
+#include <inttypes.h>
+#include <ctype.h>
+#include "esp_idf_version.h"
+#include "mdns_query.h"
+
+static const char *TAG = "QUERY";
+
+#define MAX_RESULTS 20
+
+#if ESP_IDF_VERSION < ESP_IDF_VERSION_VAL(5, 0, 0)
+/* these strings match tcpip_adapter_if_t enumeration */
+static const char * if_str[] = {"STA", "AP", "ETH", "MAX"};
+#endif
+
+/* these strings match mdns_ip_protocol_t enumeration */
+static const char * ip_protocol_str[] = {"V4", "V6", "MAX"};
+
+#if CONFIG_MDNS_DISCOVERY_TXT
+/* TXT values may be binary, print them by length and escape what is not printable */
+static void print_value(const uint8_t *value, size_t len)
+{
+	if (!value) {
+		printf("NULL");
+		return;
+	}
+	for (size_t i = 0; i < len; i++) {
+		if (isprint(value[i])) {
+			putchar(value[i]);
+		} else {
+			printf("\\x%02x", value[i]);
+		}
+	}
+}
+#endif
+
+void mdns_discovery_print_results(const mdns_result_t *results)
+{
+	const mdns_result_t *r = results;
+	int i = 1;
+	while (r) {
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 0, 0)
+		printf("%d: Interface: %s, Type: %s, TTL: %"PRIu32"\n",
+			i++, esp_netif_get_desc(r->esp_netif), ip_protocol_str[r->ip_protocol], r->ttl);
+#else
+		printf("%d: Interface: %s, Type: %s, TTL: %u\n",
+			i++, if_str[r->tcpip_if], ip_protocol_str[r->ip_protocol], r->ttl);
+#endif
+		if (r->instance_name) {
+			printf("  PTR : %s.%s.%s\n", r->instance_name, r->service_type, r->proto);
+		}
+		if (r->hostname) {
+			printf("  SRV : %s.local:%u\n", r->hostname, r->port);
+		}
+#if CONFIG_MDNS_DISCOVERY_TXT
+		if (r->txt_count) {
+			printf("  TXT : [%zu] ", r->txt_count);
+			for (int t = 0; t < r->txt_count; t++) {
+				printf("%s=", r->txt[t].key);
+				print_value((const uint8_t *)r->txt[t].value, r->txt_value_len[t]);
+				printf("(%d); ", r->txt_value_len[t]);
+			}
+			printf("\n");
+		}
+#endif
+		for (const mdns_ip_addr_t *a = r->addr; a; a = a->next) {
+#if CONFIG_MDNS_DISCOVERY_AAAA
+			if (a->addr.type == ESP_IPADDR_TYPE_V6) {
+				printf("  AAAA: " IPV6STR "\n", IPV62STR(a->addr.u_addr.ip6));
+			}
+#endif
+#if CONFIG_MDNS_DISCOVERY_A
+			if (a->addr.type == ESP_IPADDR_TYPE_V4) {
+				printf("  A   : " IPSTR "\n", IP2STR(&(a->addr.u_addr.ip4)));
+			}
+#endif
+		}
+		r = r->next;
+	}
+}
+
+#if CONFIG_MDNS_DISCOVERY_TXT
+bool mdns_discovery_txt_from_result(const mdns_result_t *result, mdns_txt_t *txt)
+{
+	bool all = true;
+	mdns_txt_clear(txt);
+	for (int t = 0; t < result->txt_count; t++) {
+		// a boolean attribute has a NULL value
+		if (!mdns_txt_add(txt, result->txt[t].key, (const uint8_t *)result->txt[t].value, result->txt_value_len[t])) {
+			all = false;
+		}
+	}
+	return all;
+}
+#endif
+
+esp_err_t mdns_discovery_query_service(const char *service, const char *proto, uint32_t timeout_ms)
+{
+	ESP_LOGI(TAG, "Query PTR: %s.%s.local", service, proto);
+
+	mdns_result_t * results = NULL;
+	esp_err_t err = mdns_query_ptr(service, proto, timeout_ms, MAX_RESULTS, &results);
+	if (err) {
+		ESP_LOGE(TAG, "Query Failed: %s", esp_err_to_name(err));
+		return err;
+	}
+	if (!results) {
+		ESP_LOGW(TAG, "No results found!");
+		return ESP_ERR_NOT_FOUND;
+	}
+	mdns_discovery_print_results(results);
+	mdns_query_results_free(results);
+	return ESP_OK;
+}
+
+esp_err_t mdns_discovery_query_host(const char *host_name, uint32_t timeout_ms, esp_ip4_addr_t *addr)
+{
+	ESP_LOGI(TAG, "Query A: %s.local", host_name);
+
+	esp_ip4_addr_t found;
+	found.addr = 0;
+	esp_err_t err = mdns_query_a(host_name, timeout_ms, &found);
+	if (err) {
+		if (err == ESP_ERR_NOT_FOUND) {
+			ESP_LOGW(TAG, "%s: Host was not found!", host_name);
+		} else {
+			ESP_LOGE(TAG, "Query Failed: %s", esp_err_to_name(err));
+		}
+		return err;
+	}
+
+	ESP_LOGI(TAG, "Query A: %s.local resolved to: " IPSTR, host_name, IP2STR(&found));
+	if (addr) *addr = found;
+	return ESP_OK;
+}
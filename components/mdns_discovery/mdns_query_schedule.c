@@ -0,0 +1,145 @@
+/* Query schedule of the watcher
+
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#include <string.h>
+#include <strings.h>
+#include "mdns_pkt.h"
+#include "mdns_query_schedule.h"
+
+/* Keep the earliest query time of all services in s->next_us */
+static void update_next(mdns_query_schedule_t *s)
+{
+	s->next_us = INT64_MAX;
+	for (size_t i = 0; i < s->size; i++) {
+		const mdns_query_service_t *q = &s->services[i];
+		if (q->used && q->next_us < s->next_us) s->next_us = q->next_us;
+	}
+}
+
+void mdns_query_schedule_init(mdns_query_schedule_t *s, mdns_query_service_t *services, size_t size)
+{
+	memset(services, 0, size * sizeof(*services));
+	s->services = services;
+	s->size = size;
+	s->count = 0;
+	s->next_us = INT64_MAX;
+}
+
+static mdns_query_service_t *find(const mdns_query_schedule_t *s, const char *service, const char *proto)
+{
+	for (size_t i = 0; i < s->size; i++) {
+		mdns_query_service_t *q = &s->services[i];
+		if (q->used && strcasecmp(q->service, service) == 0 && strcasecmp(q->proto, proto) == 0) return q;
+	}
+	return NULL;
+}
+
+const mdns_query_service_t *mdns_query_schedule_find(const mdns_query_schedule_t *s, const char *service, const char *proto)
+{
+	return find(s, service, proto);
+}
+
+bool mdns_query_schedule_add(mdns_query_schedule_t *s, const char *service, const char *proto)
+{
+	for (size_t i = 0; i < s->size; i++) {
+		mdns_query_service_t *q = &s->services[i];
+		if (q->used) continue;
+		q->used = true;
+		strcpy(q->service, service);
+		strcpy(q->proto, proto);
+		// only the new service starts from the shortest interval
+		q->next_us = 0;
+		q->interval_ms = CONFIG_MDNS_WATCHER_MIN_INTERVAL;
+		s->count++;
+		s->next_us = 0;
+		return true;
+	}
+	return false;
+}
+
+bool mdns_query_schedule_remove(mdns_query_schedule_t *s, const char *service, const char *proto)
+{
+	mdns_query_service_t *q = find(s, service, proto);
+	if (!q) return false;
+	q->used = false;
+	s->count--;
+	update_next(s);
+	return true;
+}
+
+void mdns_query_schedule_defer(mdns_query_schedule_t *s, int64_t t_us)
+{
+	for (size_t i = 0; i < s->size; i++) {
+		mdns_query_service_t *q = &s->services[i];
+		if (q->used && q->next_us < t_us) q->next_us = t_us;
+	}
+	update_next(s);
+}
+
+void mdns_query_schedule_advance(mdns_query_schedule_t *s, int64_t t_us)
+{
+	for (size_t i = 0; i < s->size; i++) {
+		mdns_query_service_t *q = &s->services[i];
+		if (q->used && q->next_us > t_us) q->next_us = t_us;
+	}
+	update_next(s);
+}
+
+/* Back off a service that was just asked for. Once its next query is due no earlier than that of
+ * a service further into its backoff, it is asked for together with that one from then on. */
+static void back_off(mdns_query_schedule_t *s, mdns_query_service_t *q, int64_t now_us)
+{
+	q->next_us = now_us + (int64_t)q->interval_ms * 1000;
+	q->interval_ms *= 2;
+	if (q->interval_ms > CONFIG_MDNS_WATCHER_MAX_INTERVAL) q->interval_ms = CONFIG_MDNS_WATCHER_MAX_INTERVAL;
+	for (size_t i = 0; i < s->size; i++) {
+		const mdns_query_service_t *r = &s->services[i];
+		if (!r->used || r == q || r->next_us <= now_us) continue;
+		if (r->interval_ms >= q->interval_ms && r->next_us <= q->next_us) {
+			q->next_us = r->next_us;
+			q->interval_ms = r->interval_ms;
+		}
+	}
+}
+
+int mdns_query_schedule_poll(mdns_query_schedule_t *s, int64_t now_us, uint8_t *buf, size_t size,
+	mdns_query_send_t send, void *ctx)
+{
+	if (!s->count || now_us < s->next_us) return 0;
+
+	size_t len = mdns_pkt_query_begin(buf, size);
+	int questions = 0, sent = 0;
+	for (size_t i = 0; i < s->size; i++) {
+		const mdns_query_service_t *q = &s->services[i];
+		if (!q->used || q->next_us > now_us) continue;
+		size_t n = mdns_pkt_query_add_ptr(buf, len, size, q->service, q->proto);
+		if (!n && questions) {
+			send(buf, len, questions, ctx);
+			sent += questions;
+			len = mdns_pkt_query_begin(buf, size);
+			questions = 0;
+			n = mdns_pkt_query_add_ptr(buf, len, size, q->service, q->proto);
+		}
+		// cannot happen with the longest names mdns_query_service_t holds and 64 byte packets
+		if (!n) continue;
+		len = n;
+		questions++;
+	}
+	if (questions) {
+		send(buf, len, questions, ctx);
+		sent += questions;
+	}
+
+	for (size_t i = 0; i < s->size; i++) {
+		mdns_query_service_t *q = &s->services[i];
+		if (q->used && q->next_us <= now_us) back_off(s, q, now_us);
+	}
+	update_next(s);
+	return sent;
+}
@@ -0,0 +1,196 @@
+/* Deadline-aware mDNS host resolver
+
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#include "mdns_log.h"
+#include <string.h>
+#include <strings.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "freertos/event_groups.h"
+#include "esp_bit_defs.h"
+#include "esp_idf_version.h"
+#include "esp_timer.h"
+#include "mdns.h"
+#include "mdns_resolve.h"
+
+static const char *TAG = "RESOLVE";
+
+#define HOSTNAME_MAX    64
+#define FRESH_US        ((int64_t)CONFIG_MDNS_RESOLVE_FRESH * 1000)
+#define USABLE_US       ((int64_t)(CONFIG_MDNS_RESOLVE_FRESH + CONFIG_MDNS_RESOLVE_STALE) * 1000)
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 0, 0)
+#define WAKE_TICKS      portMAX_DELAY           // query_done() wakes the task
+#else
+#define WAKE_TICKS      pdMS_TO_TICKS(20)       // no completion callback, poll
+#endif
+
+typedef struct {
+	char name[HOSTNAME_MAX];
+	esp_ip4_addr_t addr;
+	int64_t confirmed_us;   // 0 if the host never answered
+	int64_t used_us;
+	mdns_search_once_t *search; // query in flight, NULL if none
+} entry_t;
+
+static struct {
+	SemaphoreHandle_t lock;
+	SemaphoreHandle_t wake;
+	EventGroupHandle_t done;    // one bit per cache entry, set when its query finished
+	entry_t cache[CONFIG_MDNS_RESOLVE_CACHE_SIZE];
+} s_resolve;
+
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 0, 0)
+/* Called from the mdns task when a query ends */
+static void query_done(mdns_search_once_t *search)
+{
+	xSemaphoreGive(s_resolve.wake);
+}
+#endif
+
+/* Collect the answer of a query that ended, and free it. Called with the lock held.
+ * Returns false while the query is still running. */
+static bool collect(int slot)
+{
+	entry_t *e = &s_resolve.cache[slot];
+	mdns_result_t *results = NULL;
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 0, 0)
+	if (!mdns_query_async_get_results(e->search, 0, &results, NULL)) return false;
+#else
+	if (!mdns_query_async_get_results(e->search, 0, &results)) return false;
+#endif
+	bool found = false;
+	for (const mdns_result_t *r = results; r && !found; r = r->next) {
+		for (const mdns_ip_addr_t *a = r->addr; a && !found; a = a->next) {
+			if (a->addr.type != ESP_IPADDR_TYPE_V4) continue;
+			e->addr = a->addr.u_addr.ip4;
+			e->confirmed_us = esp_timer_get_time();
+			found = true;
+		}
+	}
+	if (!found) ESP_LOGD(TAG, "%s: no answer", e->name);
+	mdns_query_results_free(results);
+	mdns_query_async_delete(e->search);
+	e->search = NULL;
+	xEventGroupSetBits(s_resolve.done, BIT(slot));
+	return true;
+}
+
+/* Queries run concurrently, one per cache entry, so a host that does not answer
+ * does not hold up the lookup of another. This task only collects their answers. */
+static void resolve_task(void *arg)
+{
+	while (1) {
+		xSemaphoreTake(s_resolve.wake, WAKE_TICKS);
+		xSemaphoreTake(s_resolve.lock, portMAX_DELAY);
+		for (int i = 0; i < CONFIG_MDNS_RESOLVE_CACHE_SIZE; i++) {
+			if (s_resolve.cache[i].search) collect(i);
+		}
+		xSemaphoreGive(s_resolve.lock);
+	}
+}
+
+/* Start a query for slot unless one is already running. Called with the lock held. */
+static void revalidate(int slot, uint32_t timeout_ms)
+{
+	entry_t *e = &s_resolve.cache[slot];
+	if (e->search) return;
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 0, 0)
+	e->search = mdns_query_async_new(e->name, NULL, NULL, MDNS_TYPE_A, timeout_ms, 1, query_done);
+#else
+	e->search = mdns_query_async_new(e->name, NULL, NULL, MDNS_TYPE_A, timeout_ms, 1);
+#endif
+	if (!e->search) {
+		ESP_LOGW(TAG, "%s: cannot start a query", e->name);
+		xEventGroupSetBits(s_resolve.done, BIT(slot));
+		return;
+	}
+	xEventGroupClearBits(s_resolve.done, BIT(slot));
+}
+
+/* Find the entry for name, or recycle the least recently used idle entry. Called with the lock held. */
+static int lookup(const char *name)
+{
+	int victim = -1;
+	for (int i = 0; i < CONFIG_MDNS_RESOLVE_CACHE_SIZE; i++) {
+		entry_t *e = &s_resolve.cache[i];
+		if (strcasecmp(e->name, name) == 0) return i;
+		if (e->search) continue;
+		if (victim < 0 || e->used_us < s_resolve.cache[victim].used_us) victim = i;
+	}
+	if (victim >= 0) {
+		entry_t *e = &s_resolve.cache[victim];
+		memset(e, 0, sizeof(*e));
+		strlcpy(e->name, name, HOSTNAME_MAX);
+	}
+	return victim;
+}
+
+/* Fill result from a cache entry. Called with the lock held. */
+static bool usable(const entry_t *e, int64_t now, mdns_resolve_result_t *result)
+{
+	if (!e->confirmed_us || now - e->confirmed_us >= USABLE_US) return false;
+	result->addr = e->addr;
+	result->fresh = now - e->confirmed_us < FRESH_US;
+	result->age_ms = (now - e->confirmed_us) / 1000;
+	return true;
+}
+
+esp_err_t mdns_resolve_init(void)
+{
+	if (s_resolve.lock) return ESP_ERR_INVALID_STATE;
+	s_resolve.lock = xSemaphoreCreateMutex();
+	s_resolve.wake = xSemaphoreCreateBinary();
+	s_resolve.done = xEventGroupCreate();
+	if (!s_resolve.lock || !s_resolve.wake || !s_resolve.done) return ESP_ERR_NO_MEM;
+	if (xTaskCreate(resolve_task, "RESOLVE", 1024*3, NULL, 5, NULL) != pdPASS) return ESP_ERR_NO_MEM;
+	return ESP_OK;
+}
+
+esp_err_t mdns_resolve_host(const char *host_name, uint32_t deadline_ms, mdns_resolve_result_t *result)
+{
+	if (!s_resolve.lock) return ESP_ERR_INVALID_STATE;
+	if (strlen(host_name) >= HOSTNAME_MAX) return ESP_ERR_INVALID_ARG;
+
+	int64_t start = esp_timer_get_time();
+	xSemaphoreTake(s_resolve.lock, portMAX_DELAY);
+	int slot = lookup(host_name);
+	if (slot < 0) {
+		xSemaphoreGive(s_resolve.lock);
+		return ESP_ERR_NO_MEM;
+	}
+	entry_t *e = &s_resolve.cache[slot];
+	e->used_us = start;
+	if (usable(e, start, result)) {
+		if (!result->fresh) revalidate(slot, CONFIG_MDNS_RESOLVE_QUERY_TIMEOUT);
+		xSemaphoreGive(s_resolve.lock);
+		return ESP_OK;
+	}
+	// with nothing to serve meanwhile, an answer after the deadline is of no use to the caller
+	uint32_t timeout_ms = CONFIG_MDNS_RESOLVE_QUERY_TIMEOUT;
+	if (deadline_ms && deadline_ms < timeout_ms) timeout_ms = deadline_ms;
+	revalidate(slot, timeout_ms);
+	xSemaphoreGive(s_resolve.lock);
+
+	if (deadline_ms == 0) return ESP_ERR_TIMEOUT;
+	xEventGroupWaitBits(s_resolve.done, BIT(slot), pdFALSE, pdTRUE, pdMS_TO_TICKS(deadline_ms));
+
+	esp_err_t err;
+	int64_t now = esp_timer_get_time();
+	xSemaphoreTake(s_resolve.lock, portMAX_DELAY);
+	// the query may have ended right at the deadline, before the task collected it
+	if (strcasecmp(e->name, host_name) == 0 && e->search) collect(slot);
+	if (strcasecmp(e->name, host_name) == 0 && e->confirmed_us >= start && usable(e, now, result)) {
+		err = ESP_OK;
+	} else {
+		err = e->search ? ESP_ERR_TIMEOUT : ESP_ERR_NOT_FOUND;
+	}
+	xSemaphoreGive(s_resolve.lock);
+	return err;
+}
@@ -0,0 +1,169 @@
+/* Indexed TXT attributes
+
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#include <string.h>
+#include <strings.h>
+#include "mdns_txt.h"
+
+#define ITEM_MAX 255
+#define FNV_BASIS 2166136261u
+#define FNV_PRIME 16777619u
+
+static uint16_t hash_key(const uint8_t *key, size_t len)
+{
+	// FNV-1a folded to 16 bits, case insensitive because TXT keys are
+	uint32_t h = FNV_BASIS;
+	for (size_t i = 0; i < len; i++) {
+		uint8_t c = key[i];
+		if (c >= 'A' && c <= 'Z') c += 'a' - 'A';
+		h ^= c;
+		h *= FNV_PRIME;
+	}
+	h = (h >> 16) ^ (h & 0xffff);
+	return h ? h : 1;
+}
+
+/* FNV-1a over the rdata as received, continued from h */
+static uint32_t hash_rdata(uint32_t h, const uint8_t *rdata, size_t len)
+{
+	for (size_t i = 0; i < len; i++) {
+		h ^= rdata[i];
+		h *= FNV_PRIME;
+	}
+	return h;
+}
+
+static bool key_equal(const mdns_txt_t *txt, const mdns_txt_slot_t *slot, const char *name, size_t len)
+{
+	return slot->key_len == len && strncasecmp((const char *)txt->raw + slot->key, name, len) == 0;
+}
+
+static const mdns_txt_slot_t *lookup(const mdns_txt_t *txt, uint16_t hash, const char *name, size_t len)
+{
+	for (size_t n = 0, i = hash % MDNS_TXT_SLOTS; n < MDNS_TXT_SLOTS; n++, i = (i + 1) % MDNS_TXT_SLOTS) {
+		const mdns_txt_slot_t *slot = &txt->index[i];
+		if (!slot->hash) return NULL;
+		if (slot->hash == hash && key_equal(txt, slot, name, len)) return slot;
+	}
+	return NULL;
+}
+
+/* Index the item whose length byte is at raw[pos].
+ * Returns false only if the index is full; items with an empty or duplicate key are ignored. */
+static bool index_item(mdns_txt_t *txt, size_t pos)
+{
+	const uint8_t *item = txt->raw + pos + 1;
+	size_t len = txt->raw[pos];
+	const uint8_t *eq = memchr(item, '=', len);
+	size_t key_len = eq ? (size_t)(eq - item) : len;
+	if (key_len == 0) return true;
+
+	uint16_t hash = hash_key(item, key_len);
+	if (lookup(txt, hash, (const char *)item, key_len)) return true;
+	if (txt->count >= CONFIG_MDNS_TXT_MAX_KEYS) return false;
+
+	size_t i = hash % MDNS_TXT_SLOTS;
+	while (txt->index[i].hash) i = (i + 1) % MDNS_TXT_SLOTS;
+	mdns_txt_slot_t *slot = &txt->index[i];
+	slot->hash = hash;
+	slot->key = pos + 1;
+	slot->key_len = key_len;
+	slot->has_value = eq != NULL;
+	slot->value_len = eq ? len - key_len - 1 : 0;
+	txt->count++;
+	return true;
+}
+
+void mdns_txt_clear(mdns_txt_t *txt)
+{
+	txt->len = 0;
+	txt->count = 0;
+	txt->truncated = false;
+	txt->rdata_len = 0;
+	txt->rdata_hash = FNV_BASIS;
+	memset(txt->index, 0, sizeof(txt->index));
+}
+
+bool mdns_txt_set(mdns_txt_t *txt, const uint8_t *rdata, size_t len)
+{
+	mdns_txt_clear(txt);
+	txt->rdata_len = len;
+	size_t i = 0;
+	while (i < len) {
+		size_t l = rdata[i];
+		if (i + 1 + l > len) break;
+		// an empty TXT record is a single 0 length byte, nothing to keep
+		if (l) {
+			if (txt->len + 1 + l > sizeof(txt->raw)) break;
+			memcpy(txt->raw + txt->len, rdata + i, 1 + l);
+			if (!index_item(txt, txt->len)) break;
+			txt->len += 1 + l;
+		}
+		i += 1 + l;
+	}
+	txt->truncated = i < len;
+	// only needed when raw is not a copy of the rdata
+	if (txt->truncated || txt->len != len) txt->rdata_hash = hash_rdata(FNV_BASIS, rdata, len);
+	return !txt->truncated;
+}
+
+bool mdns_txt_add(mdns_txt_t *txt, const char *key, const uint8_t *value, size_t value_len)
+{
+	size_t key_len = strlen(key);
+	size_t l = value ? key_len + 1 + value_len : key_len;
+	if (key_len == 0 || l > ITEM_MAX || txt->len + 1 + l > sizeof(txt->raw)) return false;
+	if (lookup(txt, hash_key((const uint8_t *)key, key_len), key, key_len)) return false;
+
+	uint8_t *item = txt->raw + txt->len;
+	item[0] = l;
+	memcpy(item + 1, key, key_len);
+	if (value) {
+		item[1 + key_len] = '=';
+		memcpy(item + 2 + key_len, value, value_len);
+	}
+	if (!index_item(txt, txt->len)) return false;
+	if (txt->truncated || txt->len != txt->rdata_len) txt->rdata_hash = hash_rdata(txt->rdata_hash, item, 1 + l);
+	txt->rdata_len += 1 + l;
+	txt->len += 1 + l;
+	return true;
+}
+
+bool mdns_txt_equal(const mdns_txt_t *txt, const uint8_t *rdata, size_t len)
+{
+	// an empty record is a single 0 length byte, or nothing at all
+	if (txt->len == 0 && !txt->truncated && (len == 0 || (len == 1 && rdata[0] == 0))) return true;
+	if (len != txt->rdata_len) return false;
+	// raw is a copy of the rdata unless items were dropped, empty ones included
+	if (!txt->truncated && txt->len == len) return memcmp(txt->raw, rdata, len) == 0;
+	return hash_rdata(FNV_BASIS, rdata, len) == txt->rdata_hash;
+}
+
+void mdns_txt_key_init(mdns_txt_key_t *key, const char *name)
+{
+	size_t len = strlen(name);
+	key->name = name;
+	// a key this long cannot be stored, and length 0 never matches
+	key->len = len > ITEM_MAX ? 0 : len;
+	key->hash = hash_key((const uint8_t *)name, key->len);
+}
+
+const uint8_t *mdns_txt_find(const mdns_txt_t *txt, const mdns_txt_key_t *key, size_t *len)
+{
+	const mdns_txt_slot_t *slot = lookup(txt, key->hash, key->name, key->len);
+	if (!slot) return NULL;
+	*len = slot->value_len;
+	return txt->raw + slot->key + slot->key_len + slot->has_value;
+}
+
+const uint8_t *mdns_txt_get(const mdns_txt_t *txt, const char *name, size_t *len)
+{
+	mdns_txt_key_t key;
+	mdns_txt_key_init(&key, name);
+	return mdns_txt_find(txt, &key, len);
+}
@@ -0,0 +1,248 @@
+/* Multi-service mDNS watcher
+
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#include "mdns_log.h"
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "esp_timer.h"
+#include "lwip/sockets.h"
+#include "mdns_pkt.h"
+#include "mdns_query_schedule.h"
+#include "mdns_watcher.h"
+#if CONFIG_MDNS_CAPTURE
+#include "mdns_capture.h"
+#endif
+#if CONFIG_MDNS_LOW_POWER
+#include "mdns_lowpower.h"
+#endif
+
+static const char *TAG = "WATCHER";
+
+#define RX_BUF_SIZE     1460
+#define POLL_MS         100
+
+static struct {
+	SemaphoreHandle_t lock;
+	SemaphoreHandle_t done;
+	volatile bool running;
+	int sock;
+	uint16_t port;      // local port queries are sent from
+	mdns_query_service_t services[CONFIG_MDNS_WATCHER_MAX_SERVICES];
+	mdns_query_schedule_t queries;
+	mdns_peer_t slots[CONFIG_MDNS_WATCHER_MAX_PEERS];
+	mdns_peer_table_t peers;
+#if CONFIG_MDNS_DISCOVERY_METRICS
+	mdns_watcher_metrics_t metrics;
+#endif
+} s_watcher = { .sock = -1 };
+
+static bool watch_filter(const char *service, const char *proto, void *ctx)
+{
+	return mdns_query_schedule_find(&s_watcher.queries, service, proto) != NULL;
+}
+
+static void send_packet(const uint8_t *buf, size_t len, int questions, void *ctx)
+{
+	struct sockaddr_in to = {
+		.sin_family = AF_INET,
+		.sin_port = htons(MDNS_PKT_PORT),
+		.sin_addr.s_addr = inet_addr(MDNS_PKT_GROUP),
+	};
+	if (sendto(s_watcher.sock, buf, len, 0, (struct sockaddr *)&to, sizeof(to)) < 0) {
+		ESP_LOGW(TAG, "sendto failed: errno %d", errno);
+		return;
+	}
+#if CONFIG_MDNS_CAPTURE
+	mdns_capture_packet(NULL, s_watcher.port, (const uint8_t *)&to.sin_addr.s_addr, MDNS_PKT_PORT, buf, len);
+#endif
+	ESP_LOGD(TAG, "sent %d PTR questions in %d bytes", questions, (int)len);
+#if CONFIG_MDNS_DISCOVERY_METRICS
+	s_watcher.metrics.queries += questions;
+	s_watcher.metrics.packets_sent++;
+#endif
+}
+
+/* Port 5353 belongs to the mdns component: lwIP only lets a second pcb bind it when both set
+ * SO_REUSEADDR, which the mdns pcb does not. Queries are sent from an ephemeral port instead,
+ * and responders answer them with unicast responses to that port (RFC 6762 section 6.7). */
+static int open_socket(void)
+{
+	int sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+	if (sock < 0) return -1;
+
+	struct sockaddr_in addr = {
+		.sin_family = AF_INET,
+		.sin_port = 0,
+		.sin_addr.s_addr = htonl(INADDR_ANY),
+	};
+	socklen_t addrlen = sizeof(addr);
+	if (bind(sock, (struct sockaddr *)&addr, sizeof(addr)) < 0) goto fail;
+	if (getsockname(sock, (struct sockaddr *)&addr, &addrlen) < 0) goto fail;
+	s_watcher.port = ntohs(addr.sin_port);
+
+	uint8_t ttl = 255;
+	uint8_t loop = 0;
+	setsockopt(sock, IPPROTO_IP, IP_MULTICAST_TTL, &ttl, sizeof(ttl));
+	setsockopt(sock, IPPROTO_IP, IP_MULTICAST_LOOP, &loop, sizeof(loop));
+	return sock;
+
+fail:
+	ESP_LOGE(TAG, "socket setup failed: errno %d", errno);
+	close(sock);
+	return -1;
+}
+
+static void watcher_task(void *arg)
+{
+	static uint8_t rx[RX_BUF_SIZE];
+	static uint8_t tx[CONFIG_MDNS_WATCHER_PACKET_SIZE];
+
+	while (s_watcher.running) {
+		int64_t now = esp_timer_get_time();
+		xSemaphoreTakeRecursive(s_watcher.lock, portMAX_DELAY);
+#if CONFIG_MDNS_LOW_POWER
+		// queries are only sent in wake windows, when peers listen
+		int64_t delay = mdns_lowpower_delay_us();
+		if (delay) mdns_query_schedule_defer(&s_watcher.queries, now + delay);
+#endif
+		mdns_query_schedule_poll(&s_watcher.queries, now, tx, sizeof(tx), send_packet, NULL);
+#if CONFIG_MDNS_LOW_POWER
+		// a new node does not back off until it has found the peers' windows
+		uint32_t join_ms = mdns_lowpower_join_interval_ms();
+		if (join_ms) mdns_query_schedule_advance(&s_watcher.queries, now + (int64_t)join_ms * 1000);
+#endif
+		mdns_peer_table_expire(&s_watcher.peers, now);
+		int64_t wait_us = s_watcher.queries.next_us - now;
+		xSemaphoreGiveRecursive(s_watcher.lock);
+
+		fd_set rfds;
+		FD_ZERO(&rfds);
+		FD_SET(s_watcher.sock, &rfds);
+		if (wait_us > POLL_MS * 1000) wait_us = POLL_MS * 1000;
+		if (wait_us < 0) wait_us = 0;
+		struct timeval tv = { .tv_sec = 0, .tv_usec = wait_us };
+		if (select(s_watcher.sock + 1, &rfds, NULL, NULL, &tv) <= 0) continue;
+
+		struct sockaddr_in from;
+		socklen_t fromlen = sizeof(from);
+		int len = recvfrom(s_watcher.sock, rx, sizeof(rx), 0, (struct sockaddr *)&from, &fromlen);
+		if (len <= 0) continue;
+#if CONFIG_MDNS_CAPTURE
+		mdns_capture_packet((const uint8_t *)&from.sin_addr.s_addr, ntohs(from.sin_port), NULL, s_watcher.port, rx, len);
+#endif
+#if CONFIG_MDNS_LOW_POWER
+		mdns_lowpower_ingest(rx, len);
+#endif
+		xSemaphoreTakeRecursive(s_watcher.lock, portMAX_DELAY);
+#if CONFIG_MDNS_DISCOVERY_METRICS
+		s_watcher.metrics.packets_received++;
+#endif
+		mdns_peer_table_ingest(&s_watcher.peers, rx, len, esp_timer_get_time());
+		xSemaphoreGiveRecursive(s_watcher.lock);
+	}
+	xSemaphoreGive(s_watcher.done);
+	vTaskDelete(NULL);
+}
+
+esp_err_t mdns_watcher_start(mdns_peer_cb_t cb, void *ctx)
+{
+	if (s_watcher.running) return ESP_ERR_INVALID_STATE;
+
+	s_watcher.sock = open_socket();
+	if (s_watcher.sock < 0) return ESP_FAIL;
+	ESP_LOGI(TAG, "querying from port %u", s_watcher.port);
+	if (!s_watcher.lock) s_watcher.lock = xSemaphoreCreateRecursiveMutex();
+	if (!s_watcher.done) s_watcher.done = xSemaphoreCreateBinary();
+	if (!s_watcher.lock || !s_watcher.done) return ESP_ERR_NO_MEM;
+
+	mdns_query_schedule_init(&s_watcher.queries, s_watcher.services, CONFIG_MDNS_WATCHER_MAX_SERVICES);
+	mdns_peer_table_init(&s_watcher.peers, s_watcher.slots, CONFIG_MDNS_WATCHER_MAX_PEERS, watch_filter, cb, ctx);
+	// unicast responses carry TTLs of at most 10 seconds, and peers answer every query,
+	// so a peer is kept until it misses the queries of two maximum intervals
+	s_watcher.peers.min_ttl = 2 * CONFIG_MDNS_WATCHER_MAX_INTERVAL / 1000;
+
+	s_watcher.running = true;
+	if (xTaskCreate(watcher_task, "WATCHER", 1024*4, NULL, 5, NULL) != pdPASS) {
+		s_watcher.running = false;
+		close(s_watcher.sock);
+		s_watcher.sock = -1;
+		return ESP_ERR_NO_MEM;
+	}
+	return ESP_OK;
+}
+
+void mdns_watcher_stop(void)
+{
+	if (!s_watcher.running) return;
+	s_watcher.running = false;
+	xSemaphoreTake(s_watcher.done, portMAX_DELAY);
+	close(s_watcher.sock);
+	s_watcher.sock = -1;
+}
+
+esp_err_t mdns_watcher_add(const char *service, const char *proto)
+{
+	if (!s_watcher.lock) return ESP_ERR_INVALID_STATE;
+	if (strlen(service) >= MDNS_PEER_SERVICE_MAX || strlen(proto) >= MDNS_PEER_PROTO_MAX) return ESP_ERR_INVALID_ARG;
+
+	esp_err_t err = ESP_ERR_NO_MEM;
+	xSemaphoreTakeRecursive(s_watcher.lock, portMAX_DELAY);
+	if (mdns_query_schedule_find(&s_watcher.queries, service, proto)) {
+		err = ESP_OK;
+	} else if (mdns_query_schedule_add(&s_watcher.queries, service, proto)) {
+		ESP_LOGI(TAG, "watching %s.%s", service, proto);
+		err = ESP_OK;
+	}
+	xSemaphoreGiveRecursive(s_watcher.lock);
+	return err;
+}
+
+esp_err_t mdns_watcher_remove(const char *service, const char *proto)
+{
+	if (!s_watcher.lock) return ESP_ERR_INVALID_STATE;
+
+	esp_err_t err = ESP_ERR_NOT_FOUND;
+	xSemaphoreTakeRecursive(s_watcher.lock, portMAX_DELAY);
+	if (mdns_query_schedule_remove(&s_watcher.queries, service, proto)) {
+		mdns_peer_table_remove_service(&s_watcher.peers, service, proto);
+		ESP_LOGI(TAG, "stopped watching %s.%s", service, proto);
+		err = ESP_OK;
+	}
+	xSemaphoreGiveRecursive(s_watcher.lock);
+	return err;
+}
+
+size_t mdns_watcher_get_peers(mdns_peer_t *peers, size_t max)
+{
+	if (!s_watcher.lock) return 0;
+
+	size_t n = 0;
+	xSemaphoreTakeRecursive(s_watcher.lock, portMAX_DELAY);
+	for (size_t i = 0; i < CONFIG_MDNS_WATCHER_MAX_PEERS && n < max; i++) {
+		if (s_watcher.slots[i].used) peers[n++] = s_watcher.slots[i];
+	}
+	xSemaphoreGiveRecursive(s_watcher.lock);
+	return n;
+}
+
+#if CONFIG_MDNS_DISCOVERY_METRICS
+void mdns_watcher_get_metrics(mdns_watcher_metrics_t *metrics)
+{
+	if (!s_watcher.lock) {
+		memset(metrics, 0, sizeof(*metrics));
+		return;
+	}
+	xSemaphoreTakeRecursive(s_watcher.lock, portMAX_DELAY);
+	*metrics = s_watcher.metrics;
+	metrics->peers = s_watcher.peers.metrics;
+	xSemaphoreGiveRecursive(s_watcher.lock);
+}
+#endif
@@ -0,0 +1,153 @@
+#!/usr/bin/env python3
+"""Print the flash, IRAM and DRAM used by each feature of the mdns_discovery component.
+
+Reads the GNU ld map file of a build, so it needs no toolchain:
+
+    idf.py discovery-size
+    python size_report.py --archive libmdns_discovery.a build/mdns_test.map [--json]
+
+Features that are disabled in sdkconfig are not compiled and do not appear.
+Features are told apart by object file only. Options compiled in or out inside a file
+are counted under that file; to see their cost, build with and without the option and
+compare the two map files:
+
+    python size_report.py --base without.map with.map
+"""
+
+import argparse
+import json
+import re
+import sys
+
+# object file of the component -> feature (Kconfig option) it belongs to
+FEATURES = {
+    'mdns_pkt': 'packet parser',
+    'mdns_peers': 'peer table (MDNS_DISCOVERY_PTR)',
+    'mdns_watcher': 'watcher (MDNS_DISCOVERY_WATCHER)',
+    'mdns_query': 'one-shot queries (MDNS_DISCOVERY_QUERY)',
+    'mdns_naming': 'naming (MDNS_DISCOVERY_NAMING)',
+    'mdns_resolve': 'resolver (MDNS_DISCOVERY_RESOLVE)',
+    'mdns_pcap': 'capture (MDNS_CAPTURE)',
+    'mdns_capture': 'capture (MDNS_CAPTURE)',
+    'mdns_lp_schedule': 'low power (MDNS_LOW_POWER)',
+    'mdns_lowpower': 'low power (MDNS_LOW_POWER)',
+    'mdns_txt': 'TXT attributes (MDNS_DISCOVERY_TXT)',
+}
+
+# options selected with #if inside the files above, whose cost only --base shows
+IN_FILE_OPTIONS = ('MDNS_DISCOVERY_A', 'MDNS_DISCOVERY_AAAA', 'MDNS_DISCOVERY_METRICS',
+                   'MDNS_DISCOVERY_LOG_*', 'MDNS_PREPROBE')
+
+NOTE = ('Only features in their own files are broken out. Options inside a file\n'
+        '({}, ...) are counted under its feature;\n'
+        'build with and without one and compare the map files with --base to see its cost.').format(
+            ', '.join(IN_FILE_OPTIONS))
+
+MEMORY_TYPES = ('flash', 'iram', 'dram')
+
+
+def memory_type(output_section):
+    """Map an output section of the ESP-IDF linker scripts to the memory it occupies."""
+    name = output_section.lower()
+    if 'iram' in name:
+        return 'iram'
+    if 'dram' in name or name.startswith(('.data', '.bss', '.noinit')):
+        return 'dram'
+    if name.startswith(('.flash', '.text', '.rodata')):
+        return 'flash'
+    return None
+
+
+def parse_map(path, archive):
+    """Return {object: {memory type: bytes}} for the members of archive."""
+    member = re.compile(re.escape(archive) + r'\((\w+)\.c\.(?:obj|o)\)\s*$')
+    output_section = re.compile(r'^(\.\S+)')
+    # an input section on one line, or its address/size/file line following a long section name
+    input_section = re.compile(r'^ (\S+)?\s+0x([0-9a-fA-F]+)\s+0x([0-9a-fA-F]+)\s+(\S.*)$')
+    sizes = {}
+    current = None
+    in_memory_map = False
+    with open(path, errors='replace') as f:
+        for line in f:
+            line = line.rstrip('\n')
+            if not in_memory_map:
+                in_memory_map = line.startswith('Linker script and memory map')
+                continue
+            m = output_section.match(line)
+            if m:
+                current = m.group(1)
+                continue
+            m = input_section.match(line)
+            if not m or current is None:
+                continue
+            obj = member.search(m.group(4))
+            kind = memory_type(current)
+            size = int(m.group(3), 16)
+            if not obj or not kind or size == 0:
+                continue
+            counts = sizes.setdefault(obj.group(1), dict.fromkeys(MEMORY_TYPES, 0))
+            counts[kind] += size
+    return sizes
+
+
+def by_feature(sizes):
+    features = {}
+    for obj, counts in sizes.items():
+        feature = FEATURES.get(obj, obj)
+        total = features.setdefault(feature, dict.fromkeys(MEMORY_TYPES, 0))
+        for kind in MEMORY_TYPES:
+            total[kind] += counts[kind]
+    return features
+
+
+def subtract(features, base):
+    """Return the change per feature from base to features, leaving out features that did not change."""
+    zero = dict.fromkeys(MEMORY_TYPES, 0)
+    delta = {}
+    for name in set(features) | set(base):
+        change = {kind: features.get(name, zero)[kind] - base.get(name, zero)[kind] for kind in MEMORY_TYPES}
+        if any(change.values()):
+            delta[name] = change
+    return delta
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument('map_file', help='linker map file of the build')
+    parser.add_argument('--archive', default='libmdns_discovery.a', help='file name of the component library')
+    parser.add_argument('--base', metavar='MAP', help='print the change from the build with this map file')
+    parser.add_argument('--json', action='store_true', help='print JSON instead of a table')
+    args = parser.parse_args()
+
+    features = by_feature(parse_map(args.map_file, args.archive))
+    if not features:
+        print('no objects of {} found in {}'.format(args.archive, args.map_file), file=sys.stderr)
+        return 1
+    if args.base:
+        features = subtract(features, by_feature(parse_map(args.base, args.archive)))
+    total = {kind: sum(f[kind] for f in features.values()) for kind in MEMORY_TYPES}
+
+    if args.json:
+        result = {'features': features, 'total': total}
+        if args.base:
+            result['base'] = args.base
+        else:
+            result['note'] = NOTE.replace('\n', ' ')
+        json.dump(result, sys.stdout, indent=2, sort_keys=True)
+        print()
+        return 0
+
+    number = '{:>+8}' if args.base else '{:>8}'
+    row = '{:<42} ' + ' '.join([number] * 3)
+    print('{:<42} {:>8} {:>8} {:>8}'.format('feature', 'flash', 'IRAM', 'DRAM'))
+    for name in sorted(features):
+        f = features[name]
+        print(row.format(name, f['flash'], f['iram'], f['dram']))
+    print(row.format('total', total['flash'], total['iram'], total['dram']))
+    if not args.base:
+        print(NOTE)
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
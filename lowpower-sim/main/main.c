@@ -0,0 +1,352 @@
+/* Simulate low-power discovery on a virtual clock
+
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include "sdkconfig.h"
+#include "mdns_lp_schedule.h"
+#include "mdns_query_schedule.h"
+
+#define BEACON_US           102400
+#define RESPONSE_MIN_MS     20      // mDNS responders delay shared answers by 20-120 ms
+#define RESPONSE_MAX_MS     120
+#define RESPONSE_RANGE      (RESPONSE_MAX_MS - RESPONSE_MIN_MS + 1)
+
+static const uint32_t sweep[] = {50, 100, 200, 500, 1000, 2000, 5000};
+
+typedef struct {
+	double radio_pct;
+	int64_t join_p50, join_p99;
+	int join_failed;
+	int64_t lookup_p50, lookup_p99;
+} result_t;
+
+static uint64_t s_rng = CONFIG_SIM_SEED;
+static uint32_t s_first_cdf[RESPONSE_RANGE];   // P(first of the peers' answers <= RESPONSE_MIN_MS + i), in 1e-6
+
+static uint32_t rnd(uint32_t n)
+{
+	// xorshift64*, good enough and the same on every host
+	s_rng ^= s_rng >> 12;
+	s_rng ^= s_rng << 25;
+	s_rng ^= s_rng >> 27;
+	return (uint32_t)((s_rng * 2685821657736338717ULL) >> 32) % n;
+}
+
+static int64_t response_delay(void)
+{
+	return RESPONSE_MIN_MS + rnd(RESPONSE_RANGE);
+}
+
+/* Every established peer answers a query for the service, so the first answer
+ * comes after the shortest of their delays */
+static void init_first_response(int peers)
+{
+	for (int i = 0; i < RESPONSE_RANGE; i++) {
+		double later = 1;
+		for (int n = 0; n < peers; n++) later *= (double)(RESPONSE_RANGE - 1 - i) / RESPONSE_RANGE;
+		s_first_cdf[i] = (uint32_t)((1 - later) * 1000000);
+	}
+}
+
+static int64_t first_response_percentile(int pct)
+{
+	int i = 0;
+	while (i < RESPONSE_RANGE - 1 && s_first_cdf[i] < (uint32_t)pct * 10000) i++;
+	return RESPONSE_MIN_MS + i;
+}
+
+static int64_t first_response_delay(void)
+{
+	uint32_t u = rnd(1000000);
+	int i = 0;
+	while (i < RESPONSE_RANGE - 1 && u >= s_first_cdf[i]) i++;
+	return RESPONSE_MIN_MS + i;
+}
+
+static int cmp_i64(const void *a, const void *b)
+{
+	int64_t x = *(const int64_t *)a, y = *(const int64_t *)b;
+	return x < y ? -1 : x > y;
+}
+
+static int64_t percentile(int64_t *v, int n, int pct)
+{
+	if (n == 0) return -1;
+	qsort(v, n, sizeof(int64_t), cmp_i64);
+	return v[(n - 1) * pct / 100];
+}
+
+/* Radio-on share of a node that has joined: the whole window, plus one beacon per listen interval outside it */
+static double radio_pct(const mdns_lp_schedule_t *s)
+{
+	double sleep_us = (double)(s->period_ms - s->window_ms) * 1000;
+	double wakeups = sleep_us / ((double)CONFIG_MDNS_LP_LISTEN_INTERVAL * BEACON_US);
+	double on_us = (double)s->window_ms * 1000 + wakeups * CONFIG_SIM_WAKE_COST;
+	return 100.0 * on_us / ((double)s->period_ms * 1000);
+}
+
+/* Time from boot until a new node hears a peer, or -1 if it gives up after the join time.
+ * The new node keeps its radio on while joining; the established peers only listen in their windows.
+ * The watcher only receives the unicast answers to its own queries, not those to the peers' queries. */
+static int64_t simulate_join(const mdns_lp_schedule_t *cluster)
+{
+	int64_t t0 = rnd(cluster->period_ms * 16);
+	int64_t join_end = t0 + CONFIG_MDNS_LP_JOIN_TIME;
+	int64_t found = -1;
+
+	// our queries are answered only if they arrive while the peers are awake. The watcher backs off,
+	// but queries at least every join interval until it hears a peer.
+	int64_t interval = CONFIG_MDNS_WATCHER_MIN_INTERVAL;
+	int64_t join_interval = mdns_lp_join_interval(cluster);
+	for (int64_t q = t0; q < join_end; ) {
+		int64_t start = mdns_lp_window_start(cluster, q);
+		int64_t answer = q + first_response_delay();
+		if (start <= q && answer < start + cluster->window_ms) {
+			found = answer;
+			break;
+		}
+		q += interval < join_interval ? interval : join_interval;
+		interval *= 2;
+		if (interval > CONFIG_MDNS_WATCHER_MAX_INTERVAL) interval = CONFIG_MDNS_WATCHER_MAX_INTERVAL;
+	}
+	return found < 0 ? -1 : found - t0;
+}
+
+/* Time for a joined node to get an answer for a lookup made at a random time */
+static int64_t simulate_lookup(const mdns_lp_schedule_t *s)
+{
+	int64_t t = rnd(s->period_ms * 16);
+	int64_t delay = response_delay();
+	int64_t start = mdns_lp_window_start(s, t);
+	if (start <= t && t + delay >= start + s->window_ms) start += s->period_ms;
+	if (start < t) start = t;
+	return start - t + delay;
+}
+
+static void simulate(uint32_t window_ms, result_t *r)
+{
+	static int64_t join[CONFIG_SIM_TRIALS];
+	static int64_t lookup[CONFIG_SIM_TRIALS];
+	mdns_lp_schedule_t cluster = {
+		.period_ms = CONFIG_MDNS_LP_PERIOD,
+		.window_ms = window_ms,
+	};
+
+	int joined = 0;
+	r->join_failed = 0;
+	for (int i = 0; i < CONFIG_SIM_TRIALS; i++) {
+		cluster.phase_ms = rnd(CONFIG_MDNS_LP_PERIOD);
+		int64_t t = simulate_join(&cluster);
+		if (t < 0) {
+			r->join_failed++;
+		} else {
+			join[joined++] = t;
+		}
+		lookup[i] = simulate_lookup(&cluster);
+	}
+	r->radio_pct = radio_pct(&cluster);
+	r->join_p50 = percentile(join, joined, 50);
+	r->join_p99 = percentile(join, joined, 99);
+	r->lookup_p50 = percentile(lookup, CONFIG_SIM_TRIALS, 50);
+	r->lookup_p99 = percentile(lookup, CONFIG_SIM_TRIALS, 99);
+}
+
+/* A node of the cold start simulation, running the firmware's phase and query rules */
+typedef struct {
+	mdns_lp_schedule_t s;
+	int64_t boot_ms;
+	int64_t join_until_ms;
+	int64_t joined_ms;          // when it heard an established peer, -1 if it has not
+	int64_t changed_ms;         // when its phase last changed
+	mdns_query_service_t service[1];
+	mdns_query_schedule_t queries;
+} node_t;
+
+static node_t s_nodes[CONFIG_SIM_NODES + 1];
+
+static void query_sent(const uint8_t *buf, size_t len, int questions, void *ctx)
+{
+}
+
+static void boot(node_t *n, int64_t t, uint32_t phase_ms)
+{
+	n->s = (mdns_lp_schedule_t){
+		.period_ms = CONFIG_MDNS_LP_PERIOD,
+		.window_ms = CONFIG_MDNS_LP_WINDOW,
+		.phase_ms = phase_ms,
+		.joining = true,
+	};
+	n->boot_ms = t;
+	n->join_until_ms = t + CONFIG_MDNS_LP_JOIN_TIME;
+	n->joined_ms = -1;
+	n->changed_ms = t;
+	mdns_query_schedule_init(&n->queries, n->service, 1);
+	mdns_query_schedule_add(&n->queries, "_sim", "_udp");
+	mdns_query_schedule_defer(&n->queries, t * 1000);
+}
+
+/* The radio of a joining node is on, that of a joined one only in its windows */
+static bool awake(node_t *n, int64_t t)
+{
+	if (t < n->boot_ms) return false;
+	if (n->s.joining && t >= n->join_until_ms) n->s.joining = false;
+	return n->s.joining || mdns_lp_in_window(&n->s, t);
+}
+
+/* n receives the answer of peer p at t, with the TXT item p advertises */
+static void hear(node_t *n, const node_t *p, int64_t t)
+{
+	if (mdns_lp_adopt_phase(&n->s, p->s.phase_ms, p->s.joining)) n->changed_ms = t;
+	if (!p->s.joining && n->s.joining) {
+		n->s.joining = false;
+		n->joined_ms = t;
+	}
+}
+
+/* Run the watcher loop of n at its next query time: wait for the window once joined,
+ * query at least every join interval while joining, and hear the peers that are awake */
+static void step(int nodes, int i)
+{
+	static uint8_t buf[CONFIG_MDNS_WATCHER_PACKET_SIZE];
+	node_t *n = &s_nodes[i];
+	int64_t t = n->queries.next_us / 1000;
+
+	if (!awake(n, t)) {
+		mdns_query_schedule_defer(&n->queries, mdns_lp_window_start(&n->s, t) * 1000);
+		return;
+	}
+	mdns_query_schedule_poll(&n->queries, t * 1000, buf, sizeof(buf), query_sent, NULL);
+	for (int j = 0; j < nodes; j++) {
+		node_t *p = &s_nodes[j];
+		if (j == i || !awake(p, t)) continue;
+		int64_t answer = t + response_delay();
+		if (awake(p, answer) && awake(n, answer)) hear(n, p, answer);
+	}
+	if (n->s.joining) mdns_query_schedule_advance(&n->queries, (t + mdns_lp_join_interval(&n->s)) * 1000);
+}
+
+static void run_until(int nodes, int64_t end_ms)
+{
+	while (1) {
+		int next = 0;
+		for (int i = 1; i < nodes; i++) {
+			if (s_nodes[i].queries.next_us < s_nodes[next].queries.next_us) next = i;
+		}
+		if (s_nodes[next].queries.next_us > end_ms * 1000) break;
+		step(nodes, next);
+	}
+}
+
+/* Nodes that boot within one period agree on a phase, and a node joining later with a lower phase
+ * than theirs takes over their phase rather than keeping its own */
+static void simulate_cold_start(void)
+{
+	static int64_t settled[CONFIG_SIM_COLD_STARTS];
+	static int64_t late_join[CONFIG_SIM_COLD_STARTS];
+	const int nodes = CONFIG_SIM_NODES;
+	const int64_t settle_ms = CONFIG_MDNS_LP_JOIN_TIME + 3 * (int64_t)(CONFIG_MDNS_LP_PERIOD > CONFIG_MDNS_WATCHER_MAX_INTERVAL ?
+		CONFIG_MDNS_LP_PERIOD : CONFIG_MDNS_WATCHER_MAX_INTERVAL);
+	int split = 0, converged = 0, late_split = 0, cluster_moved = 0, late_joined = 0;
+
+	for (int trial = 0; trial < CONFIG_SIM_COLD_STARTS; trial++) {
+		for (int i = 0; i < nodes; i++) boot(&s_nodes[i], rnd(CONFIG_MDNS_LP_PERIOD), rnd(CONFIG_MDNS_LP_PERIOD));
+		int64_t end = CONFIG_MDNS_LP_PERIOD + settle_ms;
+		run_until(nodes, end);
+
+		uint32_t phase = s_nodes[0].s.phase_ms;
+		int64_t first = end, last = 0;
+		bool one_phase = true;
+		for (int i = 0; i < nodes; i++) {
+			if (s_nodes[i].s.phase_ms != phase) one_phase = false;
+			if (s_nodes[i].boot_ms < first) first = s_nodes[i].boot_ms;
+			if (s_nodes[i].changed_ms > last) last = s_nodes[i].changed_ms;
+		}
+		if (!one_phase) {
+			split++;
+			continue;
+		}
+		settled[converged++] = last - first;
+
+		node_t *late = &s_nodes[nodes];
+		int64_t late_boot = end + rnd(CONFIG_MDNS_LP_PERIOD);
+		boot(late, late_boot, phase ? rnd(phase) : 0);
+		run_until(nodes + 1, late_boot + settle_ms);
+		if (late->s.phase_ms != phase) late_split++;
+		for (int i = 0; i < nodes; i++) {
+			if (s_nodes[i].s.phase_ms != phase) {
+				cluster_moved++;
+				break;
+			}
+		}
+		if (late->joined_ms >= 0) late_join[late_joined++] = late->joined_ms - late_boot;
+	}
+
+	printf("cold start: %d nodes booting within one period, %d trials\n", nodes, CONFIG_SIM_COLD_STARTS);
+	printf("  split into several phases: %d, one phase p50 %"PRId64" ms, p99 %"PRId64" ms after the first boot\n",
+		split, percentile(settled, converged, 50), percentile(settled, converged, 99));
+	printf("then a node joins with a lower phase than theirs\n");
+	printf("  kept its own phase: %d, moved the cluster: %d, heard the cluster after p50 %"PRId64" ms, p99 %"PRId64" ms\n",
+		late_split, cluster_moved, percentile(late_join, late_joined, 50), percentile(late_join, late_joined, 99));
+}
+
+static void print_row(const char *mark, const char *window, const result_t *r)
+{
+	printf("%1s %8s %8.2f %10"PRId64" %10"PRId64" %9d %11"PRId64" %11"PRId64"\n", mark, window,
+		r->radio_pct, r->join_p50, r->join_p99, r->join_failed, r->lookup_p50, r->lookup_p99);
+}
+
+static void simulate_row(const char *mark, uint32_t window_ms)
+{
+	result_t r;
+	char label[12];
+	simulate(window_ms, &r);
+	snprintf(label, sizeof(label), "%"PRIu32, window_ms);
+	print_row(mark, label, &r);
+}
+
+void app_main(void)
+{
+	if (CONFIG_MDNS_LP_WINDOW >= CONFIG_MDNS_LP_PERIOD) {
+		printf("the wake window must be shorter than the period\n");
+		exit(1);
+	}
+	init_first_response(CONFIG_SIM_NODES - 1);
+	printf("period %d ms, %d nodes, listen interval %d, %d trials\n",
+		CONFIG_MDNS_LP_PERIOD, CONFIG_SIM_NODES, CONFIG_MDNS_LP_LISTEN_INTERVAL, CONFIG_SIM_TRIALS);
+	printf("  %8s %8s %10s %10s %9s %11s %11s\n",
+		"window", "radio", "join p50", "join p99", "join fail", "lookup p50", "lookup p99");
+	printf("  %8s %8s %10s %10s %9s %11s %11s\n", "(ms)", "(%)", "(ms)", "(ms)", "", "(ms)", "(ms)");
+
+	// the radio always on, as without CONFIG_MDNS_LOW_POWER
+	result_t on = {
+		.radio_pct = 100, .join_p50 = first_response_percentile(50), .join_p99 = first_response_percentile(99),
+		.lookup_p50 = (RESPONSE_MIN_MS + RESPONSE_MAX_MS) / 2, .lookup_p99 = RESPONSE_MAX_MS,
+	};
+	print_row("", "always", &on);
+
+	bool configured_done = false;
+	for (int i = 0; i < sizeof(sweep) / sizeof(sweep[0]); i++) {
+		uint32_t w = sweep[i];
+		if (!configured_done && CONFIG_MDNS_LP_WINDOW <= w) {
+			simulate_row("*", CONFIG_MDNS_LP_WINDOW);
+			configured_done = true;
+			if (w == CONFIG_MDNS_LP_WINDOW) continue;
+		}
+		if (w >= CONFIG_MDNS_LP_PERIOD) break;
+		simulate_row("", w);
+	}
+	if (!configured_done) simulate_row("*", CONFIG_MDNS_LP_WINDOW);
+	printf("* = configured window. join fail = new nodes that heard no peer within the join time.\n");
+	if (CONFIG_SIM_COLD_STARTS) simulate_cold_start();
+	exit(0);
+}
@@ -20,6 +20,16 @@
 #include "nvs_flash.h"
 #include "esp_mac.h" // esp_read_mac
 #include "mdns.h"
+#if CONFIG_MDNS_DISCOVERY_NAMING
+#include "mdns_naming.h"
+#endif
+#if CONFIG_MDNS_DISCOVERY_RESOLVE
+#include "mdns_resolve.h"
+#elif CONFIG_MDNS_DISCOVERY_QUERY
+#include "mdns_query.h"
+#else
+#error "enable the resolver or one-shot queries in the mDNS discovery menu"
+#endif
 
 static const char *TAG = "MAIN";
 
@@ -128,13 +138,27 @@ esp_err_t wifi_init_sta(void)
 }
 
 
+#if CONFIG_MDNS_DISCOVERY_NAMING
+static void hostname_changed(const char * requested, const char * actual, void * ctx)
+{
+	ESP_LOGW(TAG, "mdns hostname [%s] was taken, using [%s]", requested, actual);
+}
+#endif
+
 static void initialise_mdns(void)
 {
 	//initialize mDNS
 	ESP_ERROR_CHECK( mdns_init() );
 	//set mDNS hostname (required if you want to advertise services)
-	ESP_ERROR_CHECK( mdns_hostname_set(CONFIG_MY_HOSTNAME));
+#if CONFIG_MDNS_DISCOVERY_NAMING
+	ESP_ERROR_CHECK( mdns_naming_set_hostname(CONFIG_MY_HOSTNAME, CONFIG_MY_HOSTNAME, hostname_changed, NULL) );
+	char hostname[64];
+	ESP_ERROR_CHECK( mdns_naming_get_hostname(hostname) );
+	ESP_LOGI(TAG, "mdns hostname set to: [%s]", hostname);
+#else
+	ESP_ERROR_CHECK( mdns_hostname_set(CONFIG_MY_HOSTNAME) );
 	ESP_LOGI(TAG, "mdns hostname set to: [%s]", CONFIG_MY_HOSTNAME);
+#endif
 
 #if 0
 	//set default mDNS instance name
@@ -142,102 +166,29 @@ static void initialise_mdns(void)
 #endif
 }
 
-#if 0
-
-#if ESP_IDF_VERSION < ESP_IDF_VERSION_VAL(5, 0, 0)
-/* these strings match tcpip_adapter_if_t enumeration */
-static const char * if_str[] = {"STA", "AP", "ETH", "MAX"};
-#endif
-
-/* these strings match mdns_ip_protocol_t enumeration */
-static const char * ip_protocol_str[] = {"V4", "V6", "MAX"};
-
-static void mdns_print_results(mdns_result_t *results, char * hostname, char * ip, uint16_t *port)
-{
-	mdns_result_t *r = results;
-	mdns_ip_addr_t *a = NULL;
-	int i = 1, t;
-	while (r) {
-#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 0, 0)
-		esp_netif_get_desc(r->esp_netif);
-		printf("%d: Interface: %s, Type: %s, TTL: %"PRIu32"\n",
-			i++, esp_netif_get_desc(r->esp_netif), ip_protocol_str[r->ip_protocol], r->ttl);
-
-#else
-		printf("%d: Interface: %s, Type: %s, TTL: %u\n", 
-			i++, if_str[r->tcpip_if], ip_protocol_str[r->ip_protocol], r->ttl);
-#endif
-		if (r->instance_name) {
-			printf("  PTR : %s.%s.%s\n", r->instance_name, r->service_type, r->proto);
-		}
-		if (r->hostname) {
-			printf("  SRV : %s.local:%u\n", r->hostname, r->port);
-			strcpy(hostname, r->hostname);
-			*port = r->port;
-		}
-		if (r->txt_count) {
-			printf("  TXT : [%zu] ", r->txt_count);
-			for (t = 0; t < r->txt_count; t++) {
-				printf("%s=%s(%d); ", r->txt[t].key, r->txt[t].value ? r->txt[t].value : "NULL", r->txt_value_len[t]);
-			}
-			printf("\n");
-		}
-		a = r->addr;
-		while (a) {
-			if (a->addr.type == ESP_IPADDR_TYPE_V6) {
-				printf("  AAAA: " IPV6STR "\n", IPV62STR(a->addr.u_addr.ip6));
-			} else {
-				printf("  A   : " IPSTR "\n", IP2STR(&(a->addr.u_addr.ip4)));
-				sprintf(ip, IPSTR, IP2STR(&(a->addr.u_addr.ip4)));
-			}
-			a = a->next;
-		}
-		r = r->next;
-	}
-}
-
-static void query_mdns_service(const char * service_name, const char * proto)
-{
-	ESP_LOGI(__FUNCTION__, "Query PTR: %s.%s.local", service_name, proto);
-
-	mdns_result_t * results = NULL;
-	esp_err_t err = mdns_query_ptr(service_name, proto, 3000, 20,  &results);
-	if(err){
-		ESP_LOGE(__FUNCTION__, "Query Failed: %s", esp_err_to_name(err));
-		return;
-	}
-	if(!results){
-		ESP_LOGW(__FUNCTION__, "No results found!");
-		return;
-	}
-
-	char hostname[64];
-	char ip[16];
-	uint16_t port;
-	mdns_print_results(results, hostname, ip, &port);
-	ESP_LOGD(__FUNCTION__, "hostname=[%s] ip=[%s] port=[%d]", hostname, ip, port);
-	mdns_query_results_free(results);
-}
-#endif
-
 static void query_mdns_host(const char * host_name)
 {
+#if CONFIG_MDNS_DISCOVERY_RESOLVE
 	ESP_LOGI(__FUNCTION__, "Query A: %s.local", host_name);
 
-	struct esp_ip4_addr addr;
-	addr.addr = 0;
-
-	esp_err_t err = mdns_query_a(host_name, 2000,  &addr);
+	mdns_resolve_result_t result;
+	esp_err_t err = mdns_resolve_host(host_name, CONFIG_MDNS_RESOLVE_DEADLINE, &result);
 	if(err){
 		if(err == ESP_ERR_NOT_FOUND){
 			ESP_LOGW(__FUNCTION__, "%s: Host was not found!", host_name);
+		} else if(err == ESP_ERR_TIMEOUT){
+			ESP_LOGW(__FUNCTION__, "%s: No answer within %d ms", host_name, CONFIG_MDNS_RESOLVE_DEADLINE);
 		} else {
 			ESP_LOGE(__FUNCTION__, "Query Failed: %s", esp_err_to_name(err));
 		}
 		return;
 	}
 
-	ESP_LOGI(__FUNCTION__, "Query A: %s.local resolved to: " IPSTR, host_name, IP2STR(&addr));
+	ESP_LOGI(__FUNCTION__, "Query A: %s.local resolved to: " IPSTR " (%s, %"PRIu32" ms old)",
+		host_name, IP2STR(&result.addr), result.fresh ? "fresh" : "stale", result.age_ms);
+#else
+	mdns_discovery_query_host(host_name, CONFIG_MDNS_RESOLVE_DEADLINE, NULL);
+#endif
 }
 
 void app_main(void)
@@ -255,6 +206,9 @@ void app_main(void)
 
 	// Initialize mDNS
 	initialise_mdns();
+#if CONFIG_MDNS_DISCOVERY_RESOLVE
+	ESP_ERROR_CHECK(mdns_resolve_init());
+#endif
 
 	while(1) {
 		ESP_LOGI(TAG, "looking for [%s] on mDNS", CONFIG_YOUR_HOSTNAME);
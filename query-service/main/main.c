@@ -20,6 +20,20 @@
 #include "nvs_flash.h"
 #include "esp_mac.h" // esp_read_mac
 #include "mdns.h"
+#if CONFIG_MDNS_DISCOVERY_NAMING
+#include "mdns_naming.h"
+#endif
+#if CONFIG_MDNS_DISCOVERY_WATCHER
+#include "mdns_watcher.h"
+#else
+#error "enable service discovery and the watcher in the mDNS discovery menu"
+#endif
+#if CONFIG_MDNS_CAPTURE
+#include "mdns_capture.h"
+#endif
+#if CONFIG_MDNS_LOW_POWER
+#include "mdns_lowpower.h"
+#endif
 
 static const char *TAG = "MAIN";
 
@@ -94,7 +108,13 @@ esp_err_t wifi_init_sta(void)
 			},
 		},
 	};
+#if CONFIG_MDNS_LOW_POWER
+	// wake windows switch between WIFI_PS_NONE and WIFI_PS_MAX_MODEM
+	wifi_config.sta.listen_interval = CONFIG_MDNS_LP_LISTEN_INTERVAL;
+	ESP_ERROR_CHECK(esp_wifi_set_ps(WIFI_PS_MAX_MODEM));
+#else
 	ESP_ERROR_CHECK(esp_wifi_set_ps(WIFI_PS_NONE));
+#endif
 	ESP_ERROR_CHECK(esp_wifi_set_mode(WIFI_MODE_STA) );
 	ESP_ERROR_CHECK(esp_wifi_set_config(WIFI_IF_STA, &wifi_config) );
 	ESP_ERROR_CHECK(esp_wifi_start() );
@@ -142,6 +162,13 @@ static char* generate_hostname(void)
 	return hostname;
 }
 
+#if CONFIG_MDNS_DISCOVERY_NAMING
+static void hostname_changed(const char * requested, const char * actual, void * ctx)
+{
+	ESP_LOGW(TAG, "mdns hostname [%s] was taken, using [%s]", requested, actual);
+}
+#endif
+
 static void initialise_mdns(void)
 {
 	char * hostname = generate_hostname();
@@ -149,9 +176,17 @@ static void initialise_mdns(void)
 	//initialize mDNS
 	ESP_ERROR_CHECK( mdns_init() );
 	//set mDNS hostname (required if you want to advertise services)
+#if CONFIG_MDNS_DISCOVERY_NAMING
+	ESP_ERROR_CHECK( mdns_naming_set_hostname(hostname, CONFIG_MDNS_HOSTNAME, hostname_changed, NULL) );
+	free(hostname);
+	char actual[64];
+	ESP_ERROR_CHECK( mdns_naming_get_hostname(actual) );
+	ESP_LOGI(__FUNCTION__, "mdns hostname set to: [%s]", actual);
+#else
 	ESP_ERROR_CHECK( mdns_hostname_set(hostname) );
 	ESP_LOGI(__FUNCTION__, "mdns hostname set to: [%s]", hostname);
 	free(hostname);
+#endif
 
 	//set default mDNS instance name
 	ESP_ERROR_CHECK( mdns_instance_name_set(CONFIG_MDNS_INSTANCE) );
@@ -177,102 +212,62 @@ static void initialise_mdns(void)
 #endif
 }
 
-#if ESP_IDF_VERSION < ESP_IDF_VERSION_VAL(5, 0, 0)
-/* these strings match tcpip_adapter_if_t enumeration */
-static const char * if_str[] = {"STA", "AP", "ETH", "MAX"};
-#endif
-
-/* these strings match mdns_ip_protocol_t enumeration */
-static const char * ip_protocol_str[] = {"V4", "V6", "MAX"};
-
-static void mdns_print_results(mdns_result_t *results, char * hostname, char * ip, uint16_t *port)
+static void print_peer(int index, const mdns_peer_t *peer)
 {
-	mdns_result_t *r = results;
-	mdns_ip_addr_t *a = NULL;
-	int i = 1, t;
-	while (r) {
-#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 0, 0)
-		esp_netif_get_desc(r->esp_netif);
-		printf("%d: Interface: %s, Type: %s, TTL: %"PRIu32"\n",
-			i++, esp_netif_get_desc(r->esp_netif), ip_protocol_str[r->ip_protocol], r->ttl);
-
-#else
-		printf("%d: Interface: %s, Type: %s, TTL: %u\n", 
-			i++, if_str[r->tcpip_if], ip_protocol_str[r->ip_protocol], r->ttl);
+	printf("%d: PTR : %s.%s.%s\n", index, peer->instance, peer->service, peer->proto);
+	if (peer->hostname[0]) {
+		printf("  SRV : %s.local:%u\n", peer->hostname, peer->port);
+	}
+#if CONFIG_MDNS_DISCOVERY_A
+	if (peer->ip4[0]) {
+		printf("  A   : %d.%d.%d.%d\n", peer->ip4[0], peer->ip4[1], peer->ip4[2], peer->ip4[3]);
+	}
 #endif
-		if (r->instance_name) {
-			printf("  PTR : %s.%s.%s\n", r->instance_name, r->service_type, r->proto);
+#if CONFIG_MDNS_DISCOVERY_AAAA
+	static const uint8_t zero[16];
+	if (memcmp(peer->ip6, zero, sizeof(zero))) {
+		printf("  AAAA: ");
+		for (int i = 0; i < 16; i += 2) {
+			printf("%02x%02x%s", peer->ip6[i], peer->ip6[i + 1], i < 14 ? ":" : "\n");
 		}
-		if (r->hostname) {
-			printf("  SRV : %s.local:%u\n", r->hostname, r->port);
-			strcpy(hostname, r->hostname);
-			*port = r->port;
-		}
-		if (r->txt_count) {
-			printf("  TXT : [%zu] ", r->txt_count);
-			for (t = 0; t < r->txt_count; t++) {
-				printf("%s=%s(%d); ", r->txt[t].key, r->txt[t].value ? r->txt[t].value : "NULL", r->txt_value_len[t]);
-			}
-			printf("\n");
-		}
-		a = r->addr;
-		while (a) {
-			if (a->addr.type == ESP_IPADDR_TYPE_V6) {
-				printf("  AAAA: " IPV6STR "\n", IPV62STR(a->addr.u_addr.ip6));
-			} else {
-				printf("  A   : " IPSTR "\n", IP2STR(&(a->addr.u_addr.ip4)));
-				sprintf(ip, IPSTR, IP2STR(&(a->addr.u_addr.ip4)));
-			}
-			a = a->next;
+	}
+#endif
+#if CONFIG_MDNS_DISCOVERY_TXT
+	if (peer->txt.count) {
+		size_t len;
+		const uint8_t *board = mdns_txt_get(&peer->txt, "board", &len);
+		if (board) {
+			printf("  TXT : [%u] board=%.*s\n", peer->txt.count, (int)len, board);
+		} else {
+			printf("  TXT : [%u]\n", peer->txt.count);
 		}
-		r = r->next;
 	}
+#endif
 }
 
-static void query_mdns_service(const char * service_name, const char * proto)
+static void peer_event(const mdns_peer_t *peer, mdns_peer_event_t event, void *ctx)
 {
-	ESP_LOGI(__FUNCTION__, "Query PTR: %s.%s.local", service_name, proto);
-
-	mdns_result_t * results = NULL;
-	esp_err_t err = mdns_query_ptr(service_name, proto, 3000, 20,  &results);
-	if(err){
-		ESP_LOGE(__FUNCTION__, "Query Failed: %s", esp_err_to_name(err));
-		return;
-	}
-	if(!results){
-		ESP_LOGW(__FUNCTION__, "No results found!");
-		return;
-	}
-
-	char hostname[64];
-	char ip[16];
-	uint16_t port;
-	mdns_print_results(results, hostname, ip, &port);
-	ESP_LOGD(__FUNCTION__, "hostname=[%s] ip=[%s] port=[%d]", hostname, ip, port);
-	mdns_query_results_free(results);
+	static const char * event_str[] = {"added", "updated", "removed"};
+	ESP_LOGI(TAG, "peer %s: %s.%s.%s", event_str[event], peer->instance, peer->service, peer->proto);
 }
 
-#if 0
-static void query_mdns_host(const char * host_name)
+/* Watch every <service>.<proto> pair in a space separated list */
+static void watch_services(const char * list)
 {
-	ESP_LOGI(__FUNCTION__, "Query A: %s.local", host_name);
-
-	struct esp_ip4_addr addr;
-	addr.addr = 0;
-
-	esp_err_t err = mdns_query_a(host_name, 2000,  &addr);
-	if(err){
-		if(err == ESP_ERR_NOT_FOUND){
-			ESP_LOGW(__FUNCTION__, "%s: Host was not found!", host_name);
-		} else {
-			ESP_LOGE(__FUNCTION__, "Query Failed: %s", esp_err_to_name(err));
+	char buf[128];
+	strlcpy(buf, list, sizeof(buf));
+	char *save = NULL;
+	for (char *item = strtok_r(buf, " ", &save); item; item = strtok_r(NULL, " ", &save)) {
+		char *dot = strchr(item, '.');
+		if (!dot) {
+			ESP_LOGW(TAG, "ignoring [%s], expected <service>.<proto>", item);
+			continue;
 		}
-		return;
+		*dot = 0;
+		ESP_LOGI(TAG, "looking for [%s.%s] on mDNS", item, dot + 1);
+		ESP_ERROR_CHECK(mdns_watcher_add(item, dot + 1));
 	}
-
-	ESP_LOGI(__FUNCTION__, "Query A: %s.local resolved to: " IPSTR, host_name, IP2STR(&addr));
 }
-#endif
 
 void app_main(void)
 {
@@ -290,11 +285,29 @@ void app_main(void)
 	// Initialize mDNS
 	initialise_mdns();
 
+#if CONFIG_MDNS_CAPTURE
+	// Start streaming mDNS traffic
+	ESP_ERROR_CHECK(mdns_capture_start());
+#endif
+
+	// Start watching services
+	ESP_ERROR_CHECK(mdns_watcher_start(peer_event, NULL));
 	char service_type[64];
 	sprintf(service_type, "_service_%d", CONFIG_UDP_PORT); //prepended with underscore
+#if CONFIG_MDNS_LOW_POWER
+	ESP_ERROR_CHECK(mdns_lowpower_start(service_type, "_udp"));
+#endif
+	ESP_LOGI(TAG, "looking for [%s] on mDNS", service_type);
+	ESP_ERROR_CHECK(mdns_watcher_add(service_type, "_udp"));
+	watch_services(CONFIG_MDNS_WATCH_SERVICES);
+
+	static mdns_peer_t peers[CONFIG_MDNS_WATCHER_MAX_PEERS];
 	while(1) {
-		ESP_LOGI(TAG, "looking for [%s] on mDNS", service_type);
-		query_mdns_service(service_type, "_udp");
-		vTaskDelay(100);
+		size_t count = mdns_watcher_get_peers(peers, CONFIG_MDNS_WATCHER_MAX_PEERS);
+		ESP_LOGI(TAG, "%zu peers", count);
+		for (int i = 0; i < count; i++) {
+			print_peer(i + 1, &peers[i]);
+		}
+		vTaskDelay(pdMS_TO_TICKS(10000));
 	}
 }
@@ -0,0 +1,211 @@
+/* Replay a mDNS capture into the peer table
+
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <inttypes.h>
+#include <string.h>
+#include <time.h>
+#include "esp_log.h"
+#include "mdns_pcap.h"
+#include "mdns_peers.h"
+#include "mdns_query_schedule.h"
+
+static const char *TAG = "REPLAY";
+
+static mdns_query_service_t s_watched_services[CONFIG_REPLAY_MAX_SERVICES];
+static mdns_query_schedule_t s_watched;
+
+typedef struct {
+	uint32_t added;
+	uint32_t updated;
+	uint32_t removed;
+	size_t max_peers;
+} replay_stats_t;
+
+static int64_t wall_ns(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/* Write the results in the format of benchmark.json */
+static bool write_json(const char *path, const char *capture, uint32_t packets, const replay_stats_t *stats, double ns)
+{
+	FILE *f = fopen(path, "w");
+	if (!f) return false;
+	fprintf(f, "{\n  \"capture\": \"");
+	for (const char *c = capture; *c; c++) {
+		if (*c == '"' || *c == '\\') fputc('\\', f);
+		fputc(*c, f);
+	}
+	fprintf(f, "\",\n  \"metrics\": {\n");
+	fprintf(f, "    \"packets\": {\"value\": %"PRIu32", \"unit\": \"packets\", \"threshold\": null, \"pass\": true},\n", packets);
+	fprintf(f, "    \"peers_max\": {\"value\": %zu, \"unit\": \"peers\", \"threshold\": null, \"pass\": true},\n", stats->max_peers);
+	fprintf(f, "    \"ingest_per_packet\": {\"value\": %.3f, \"unit\": \"ns\", ", ns);
+	if (CONFIG_REPLAY_LIMIT_INGEST > 0) {
+		fprintf(f, "\"threshold\": %d, \"pass\": %s}\n", CONFIG_REPLAY_LIMIT_INGEST,
+			ns <= CONFIG_REPLAY_LIMIT_INGEST ? "true" : "false");
+	} else {
+		fprintf(f, "\"threshold\": null, \"pass\": true}\n");
+	}
+	fprintf(f, "  }\n}\n");
+	return fclose(f) == 0;
+}
+
+static uint8_t *load_file(const char *path, size_t *len)
+{
+	FILE *f = fopen(path, "rb");
+	if (!f) return NULL;
+	fseek(f, 0, SEEK_END);
+	long size = ftell(f);
+	fseek(f, 0, SEEK_SET);
+	uint8_t *buf = size > 0 ? malloc(size) : NULL;
+	if (buf && fread(buf, 1, size, f) != (size_t)size) {
+		free(buf);
+		buf = NULL;
+	}
+	fclose(f);
+	*len = size;
+	return buf;
+}
+
+/* The watcher only keeps peers of the services it watches. An empty list keeps every service. */
+static bool watch_filter(const char *service, const char *proto, void *ctx)
+{
+	return !s_watched.count || mdns_query_schedule_find(&s_watched, service, proto) != NULL;
+}
+
+/* Watch every <service>.<proto> pair in a space separated list, like query-service */
+static void watch_services(const char *list)
+{
+	char buf[256];
+	snprintf(buf, sizeof(buf), "%s", list);
+	char *save = NULL;
+	for (char *item = strtok_r(buf, " ", &save); item; item = strtok_r(NULL, " ", &save)) {
+		char *dot = strchr(item, '.');
+		if (!dot || dot - item >= MDNS_PEER_SERVICE_MAX || strlen(dot + 1) >= MDNS_PEER_PROTO_MAX) {
+			ESP_LOGW(TAG, "ignoring [%s], expected <service>.<proto>", item);
+			continue;
+		}
+		*dot = 0;
+		if (!mdns_query_schedule_add(&s_watched, item, dot + 1)) {
+			ESP_LOGW(TAG, "ignoring [%s.%s], too many services", item, dot + 1);
+		}
+	}
+}
+
+static void peer_event(const mdns_peer_t *peer, mdns_peer_event_t event, void *ctx)
+{
+	replay_stats_t *stats = ctx;
+	if (event == MDNS_PEER_ADDED) stats->added++;
+	if (event == MDNS_PEER_UPDATED) stats->updated++;
+	if (event == MDNS_PEER_REMOVED) stats->removed++;
+}
+
+static void print_peers(const mdns_peer_table_t *table)
+{
+	int i = 1;
+	for (size_t n = 0; n < table->size; n++) {
+		const mdns_peer_t *peer = &table->slots[n];
+		if (!peer->used) continue;
+		printf("%d: PTR : %s.%s.%s\n", i++, peer->instance, peer->service, peer->proto);
+		if (peer->hostname[0]) {
+			printf("  SRV : %s.local:%u\n", peer->hostname, peer->port);
+		}
+#if CONFIG_MDNS_DISCOVERY_A
+		if (peer->ip4[0]) {
+			printf("  A   : %d.%d.%d.%d\n", peer->ip4[0], peer->ip4[1], peer->ip4[2], peer->ip4[3]);
+		}
+#endif
+	}
+}
+
+void app_main(void)
+{
+	const char *path = getenv("MDNS_REPLAY_FILE");
+	if (!path) path = CONFIG_REPLAY_FILE;
+
+	size_t len = 0;
+	uint8_t *capture = load_file(path, &len);
+	if (!capture) {
+		ESP_LOGE(TAG, "cannot read %s", path);
+		exit(2);
+	}
+
+	const char *services = getenv("MDNS_REPLAY_SERVICES");
+	if (!services) services = CONFIG_REPLAY_SERVICES;
+	mdns_query_schedule_init(&s_watched, s_watched_services, CONFIG_REPLAY_MAX_SERVICES);
+	watch_services(services);
+
+	static mdns_peer_t slots[CONFIG_REPLAY_MAX_PEERS];
+	mdns_peer_table_t table;
+	replay_stats_t stats;
+	uint32_t packets = 0;
+	uint64_t bytes = 0;
+	int64_t first_us = 0, last_us = 0;
+	int64_t ingest_ns = 0;
+
+	for (int iter = 0; iter < CONFIG_REPLAY_ITERATIONS; iter++) {
+		mdns_pcap_reader_t reader;
+		mdns_pcap_packet_t pkt;
+		if (!mdns_pcap_reader_init(&reader, capture, len)) {
+			ESP_LOGE(TAG, "%s is not a supported pcap file", path);
+			exit(2);
+		}
+		memset(&stats, 0, sizeof(stats));
+		mdns_peer_table_init(&table, slots, CONFIG_REPLAY_MAX_PEERS, watch_filter, peer_event, &stats);
+		// the same lifetime as the watcher, whose unicast answers carry TTLs of at most 10 seconds
+		table.min_ttl = 2 * CONFIG_MDNS_WATCHER_MAX_INTERVAL / 1000;
+		packets = 0;
+		bytes = 0;
+
+		// The peer table only sees capture timestamps, so the replay runs on virtual time
+		// as fast as the host allows.
+		while (mdns_pcap_reader_next(&reader, &pkt)) {
+			if (!packets) first_us = pkt.ts_us;
+			last_us = pkt.ts_us;
+			packets++;
+			bytes += pkt.len;
+
+			int64_t start = wall_ns();
+			mdns_peer_table_expire(&table, pkt.ts_us);
+			mdns_peer_table_ingest(&table, pkt.payload, pkt.len, pkt.ts_us);
+			ingest_ns += wall_ns() - start;
+			if (table.count > stats.max_peers) stats.max_peers = table.count;
+		}
+	}
+
+	if (getenv("MDNS_REPLAY_VERBOSE")) print_peers(&table);
+
+	uint64_t total = (uint64_t)packets * CONFIG_REPLAY_ITERATIONS;
+	double ns = total ? (double)ingest_ns / total : 0.0;
+	ESP_LOGI(TAG, "%s: %"PRIu32" mDNS packets, %"PRIu64" bytes, %.3f s of traffic",
+		path, packets, bytes, (last_us - first_us) / 1e6);
+	ESP_LOGI(TAG, "peers: %"PRIu32" added, %"PRIu32" updated, %"PRIu32" removed, %zu at end, %zu max",
+		stats.added, stats.updated, stats.removed, table.count, stats.max_peers);
+	ESP_LOGI(TAG, "ingest: %d iterations, %.1f ns/packet", CONFIG_REPLAY_ITERATIONS, ns);
+	free(capture);
+
+	const char *json = getenv("MDNS_REPLAY_JSON");
+	if (!json) json = CONFIG_REPLAY_JSON_FILE;
+	if (!write_json(json, path, packets, &stats, ns)) {
+		ESP_LOGE(TAG, "cannot write %s", json);
+		exit(2);
+	}
+	ESP_LOGI(TAG, "results written to %s", json);
+
+	if (CONFIG_REPLAY_LIMIT_INGEST > 0 && ns > CONFIG_REPLAY_LIMIT_INGEST) {
+		ESP_LOGE(TAG, "ingest cost %.1f ns/packet is past the threshold of %d", ns, CONFIG_REPLAY_LIMIT_INGEST);
+		exit(1);
+	}
+	exit(0);
+}